@@ -15,7 +15,6 @@ int main(int argc, char **argv) {
   using cfg::bind;
 
   const double expected{argc > 1 ? std::stod(argv[1]) : 0};
-  const bool skip_space{true};
 
   cfg::text_encoding enc{}; // Specifies format when converting to string
   cfg::lexer_table_t tbl{};
@@ -44,6 +43,14 @@ int main(int argc, char **argv) {
   cfg::add_entry(&tbl, cfg::token_type::free, "zero", "0");
   cfg::add_entry(&tbl, cfg::token_type::free, "positive", "[1-9]");
 
+  // The table is compiled into a single automaton, which the scanner runs
+  // over the raw input, so it does not have to be split beforehand.
+  cfg::lexer_automaton dfa{};
+  if (cfg::compile(&tbl, &dfa) != cfg::result::success) {
+    std::cerr << "Error: compiling the token table failed" << std::endl;
+    return 4;
+  }
+
   /* ORIGINAL PRE-CNF CONVERSION GRAMMAR:
   {
     cfg::grammar_t o{};
@@ -305,14 +312,19 @@ int main(int argc, char **argv) {
       std::getline(std::cin, cli);
     }
 
-    // This utility function splits the input string,
-    // omitting any empty spaces in between.
-    const auto input = flt::split<std::vector, std::string>(cli, skip_space);
-
-    // This function invokes the lexer, returning tokens that include
-    // the IDs from the table above, along with the specific values
-    // matching the regex of the corresponding entries.
-    const auto tokens = cfg::tokenize(&tbl, &input);
+    // This function scans the input with the automaton, taking the longest
+    // match at every position and skipping the spaces in between. Each
+    // token includes the ID from the table above, along with the specific
+    // value matching the regex of the corresponding entry.
+    std::vector<cfg::token_t> tokens{};
+    if (cfg::scan(&tbl, &dfa, cli, [&tokens](cfg::token_t &&t) {
+          tokens.push_back(std::move(t));
+        }) != cfg::result::success) {
+      std::cerr << "Error: scanning the input failed" << std::endl;
+      if (argc > 1)
+        return 2;
+      continue;
+    }
 
     // Finally, we use our grammar, tokens, and callback_map to validate
     // the sequence according to the grammar. For each parse tree, a sequence
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cfgtk/parser.hpp>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace cfg {
+// A fixed-size set of symbol ids stored as a bitset
+class symbol_set {
+public:
+  symbol_set() = default;
+  explicit symbol_set(std::size_t size)
+      : words((size + word_bits - 1) / word_bits), bits{size} {}
+
+  bool test(std::size_t i) const {
+    return words[i / word_bits] & (word_t{1} << (i % word_bits));
+  }
+
+  void set(std::size_t i) {
+    words[i / word_bits] |= word_t{1} << (i % word_bits);
+  }
+
+  // Adds every element of o; returns whether the set grew
+  bool merge(const symbol_set &o) {
+    bool changed{false};
+    for (std::size_t w = 0; w < words.size() && w < o.words.size(); ++w) {
+      const auto merged = words[w] | o.words[w];
+      changed = changed || merged != words[w];
+      words[w] = merged;
+    }
+    return changed;
+  }
+
+  std::size_t count() const {
+    std::size_t n{};
+    for (const auto w : words)
+      n += std::popcount(w);
+    return n;
+  }
+
+  std::size_t size() const { return bits; }
+
+private:
+  using word_t = std::uint64_t;
+  static constexpr std::size_t word_bits{64};
+
+  std::vector<word_t> words{};
+  std::size_t bits{};
+};
+
+// The sets analyze computes; FIRST and FOLLOW take memory quadratic in the
+// number of symbols, so passes only ask for what they use.
+enum class analysis_set : unsigned {
+  nullable = 1 << 0,
+  productive = 1 << 1,
+  reachable = 1 << 2,
+  first = 1 << 3,
+  follow = 1 << 4,
+  all = (1 << 5) - 1
+};
+
+inline constexpr analysis_set operator|(analysis_set a, analysis_set b) {
+  return static_cast<analysis_set>(static_cast<unsigned>(a) |
+                                   static_cast<unsigned>(b));
+}
+
+inline constexpr analysis_set operator&(analysis_set a, analysis_set b) {
+  return static_cast<analysis_set>(static_cast<unsigned>(a) &
+                                   static_cast<unsigned>(b));
+}
+
+// Properties of every symbol of a grammar, computed once and shared by the
+// passes that need them. Non-terminals come first, numbered in the order of
+// their first definition, so the start symbol is 0; terminals follow in the
+// order of their first appearance.
+struct grammar_analysis {
+  std::vector<symbol_t> symbols{};
+  std::unordered_map<symbol_t, symbol_id_t> ids{};
+  std::size_t nonterminals{};
+  symbol_id_t start{};
+  // The sets below that were computed; the others are empty
+  analysis_set computed{};
+
+  symbol_set nullable{};
+  symbol_set productive{};
+  symbol_set reachable{};
+
+  // Indexed by symbol id; the FIRST set of a terminal is the terminal itself
+  std::vector<symbol_set> first{};
+  // Indexed by non-terminal id; end_of_input() marks the end of the input
+  std::vector<symbol_set> follow{};
+
+  bool is_terminal(symbol_id_t s) const { return s >= nonterminals; }
+  symbol_id_t end_of_input() const {
+    return static_cast<symbol_id_t>(symbols.size());
+  }
+
+  bool has(analysis_set s) const { return (computed & s) == s; }
+
+  symbol_id_t get_id(const symbol_t &s) const {
+    const auto it = ids.find(s);
+    return it == ids.end() ? no_symbol : it->second;
+  }
+};
+
+// What remove_useless took out of a grammar; repeated calls accumulate
+struct useless_report {
+  std::vector<symbol_t> unproductive{};
+  std::vector<symbol_t> unreachable{};
+  std::size_t rules{};
+};
+
+result analyze(const grammar_t *, grammar_analysis *,
+               analysis_set = analysis_set::all);
+result analyze(const std::vector<const rule *> *, grammar_analysis *,
+               analysis_set = analysis_set::all);
+
+// Removes the rules of non-terminals that derive no terminal string, the
+// rules using them, and then the rules of non-terminals the start symbol
+// no longer reaches; the two steps in this order leave no useless symbol.
+// Fails with match_failure, leaving the grammar as is, when the start
+// symbol itself derives nothing.
+result remove_useless(grammar_t *, useless_report * = nullptr);
+} // namespace cfg
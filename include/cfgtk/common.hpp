@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <fstream>
+#include <limits>
 #include <string>
+#include <string_view>
 
 namespace cfg {
 
@@ -22,6 +25,19 @@ enum class result {
 using symbol_t = std::string;
 using token_t = token<symbol_t>;
 
+constexpr std::uint32_t no_token_entry{
+    std::numeric_limits<std::uint32_t>::max()};
+
+// A token that refers to its text instead of owning it: the id points into
+// the lexer table and the value into the lexer input, so it is valid for
+// as long as both are
+struct token_ref {
+  // The index of the matched table entry, no_token_entry if none matched
+  std::uint32_t entry{no_token_entry};
+  std::string_view id{};
+  std::string_view value{};
+};
+
 inline result write_to_file(const std::string &p, const std::string &d) {
   if (d.size()) {
     std::ofstream str{p};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cfgtk/parser.hpp>
+#include <atomic>
+#include <memory>
+
+namespace cfg {
+// Identifies a source rule of an incremental_grammar; the rules of the
+// grammar it was built from are numbered in order, added rules follow.
+using rule_handle_t = std::size_t;
+
+struct incremental_state;
+
+struct incremental_stats {
+  std::size_t full{};
+  std::size_t partial{};
+};
+
+// A CNF conversion that remembers which CNF rules every source rule
+// produced, so that adding, removing or replacing a source rule re-derives
+// only those. Changes to the grammar as a whole, to its non-terminals,
+// nullable symbols or unit rules, fall back to a full conversion.
+//
+// The conversion performs the term, bin, del and unit steps, with one
+// proxy per terminal; duplicate rules are counted rather than removed by a
+// pass. The current grammar is published as a compiled snapshot that
+// parses on other threads can keep using while a newer one is swapped in.
+struct incremental_grammar {
+  incremental_grammar();
+  incremental_grammar(const incremental_grammar &) = delete;
+  incremental_grammar &operator=(const incremental_grammar &) = delete;
+  ~incremental_grammar();
+
+  std::unique_ptr<incremental_state> state{};
+  std::atomic<std::shared_ptr<const compiled_grammar>> snapshot{};
+  incremental_stats stats{};
+};
+
+result to_cnf(const grammar_t *, incremental_grammar *);
+
+result add_rule(incremental_grammar *, rule, rule_handle_t * = nullptr);
+result remove_rule(incremental_grammar *, rule_handle_t);
+result replace_rule(incremental_grammar *, rule_handle_t, rule);
+
+// The current CNF grammar, start rules first
+result get_grammar(const incremental_grammar *, grammar_t *);
+
+// Compiles the current grammar and atomically replaces the snapshot
+result publish(incremental_grammar *);
+std::shared_ptr<const compiled_grammar>
+get_snapshot(const incremental_grammar *);
+} // namespace cfg
@@ -2,29 +2,197 @@
 
 #include <cfgtk/common.hpp>
 #include <cfgtk/filter.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
 #include <ostream>
 #include <regex>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace cfg {
 enum class token_type { option, flag, free };
 
+// The strings a pattern made only of literal alternatives matches, like
+// --salt|-s; fails with match_failure for any other pattern
+result get_literals(const std::string &pattern, std::vector<std::string> *);
+
+// Emits a standalone, table-specialized lexer giving the same tokens as
+// tokenize, with the token ids as an enum and the automaton as switches;
+// the generated code does not depend on cfgtk.
+struct lexer_encoding {
+  std::string namespace_name{"lex"};
+  bool include_guard{true};
+};
+
+// Selects the lexer_entry constructor that keeps the pattern source
+// without compiling it
+struct uncompiled_t {};
+inline constexpr uncompiled_t uncompiled{};
+
 struct lexer_entry {
   lexer_entry(token_type t, std::string i, std::string p)
-      : type{t}, id{std::move(i)}, pattern{p}, regex{std::move(p)} {}
+      : type{t}, id{std::move(i)}, pattern{p}, regex{std::move(p)} {
+    literal = get_literals(regex, &literals) == result::success;
+  }
+
+  // The pattern is left empty; where no automaton compiled from the table
+  // covers the entry, tokenize compiles its source on first use
+  lexer_entry(token_type t, std::string i, std::string p, uncompiled_t)
+      : type{t}, id{std::move(i)}, compiled{false}, regex{std::move(p)} {
+    literal = get_literals(regex, &literals) == result::success;
+  }
 
   token_type type{};
   symbol_t id{};
   std::regex pattern{};
+  // Whether the pattern was compiled from the source
+  bool compiled{true};
   std::string regex{};
+  // Literal entries are looked up by these instead of matching the pattern
+  bool literal{};
+  std::vector<std::string> literals{};
 };
 
 using lexer_table_t = std::vector<lexer_entry>;
 using lexer_input_t = std::vector<std::string>;
 
+// All patterns of a table combined into one minimized DFA over bytes. Each
+// state lists the entries whose patterns match the input read so far, in
+// table order, so the first match of a kind is found with a single scan.
+struct lexer_automaton {
+  // The size and the fingerprint of the table it was compiled from; a
+  // default constructed automaton belongs to no table
+  std::size_t entries{};
+  std::uint64_t fingerprint{};
+  std::array<std::uint8_t, 256> classes{};
+  std::uint32_t class_count{};
+  std::uint32_t start{};
+  // No input leads out of this state and no entry accepts in it
+  std::uint32_t reject{};
+  // The transitions of state s start at s * class_count
+  std::vector<std::uint32_t> transitions{};
+  // The entries accepting in state s are the accepts from
+  // accept_offsets[s] up to accept_offsets[s + 1]
+  std::vector<std::uint32_t> accept_offsets{};
+  std::vector<std::uint32_t> accepts{};
+  // Entries whose patterns use features the automaton does not cover;
+  // they are still matched by their std::regex
+  std::vector<std::uint32_t> fallback{};
+};
+
+result compile(const lexer_table_t *, lexer_automaton *);
+
+// Identifies the contents of a table: the type, the id and the pattern
+// source of every entry, in order
+std::uint64_t get_fingerprint(const lexer_table_t *);
+
+// Whether the automaton is well formed and was compiled from a table with
+// these contents; tokenize and scan do not use it otherwise
+bool is_compiled_from(const lexer_automaton *, const lexer_table_t *);
+
+// The entries of the automaton, fallbacks aside, matching the whole input;
+// none when the automaton was never compiled
+std::span<const std::uint32_t> get_matches(const lexer_automaton *,
+                                           std::string_view);
+
 std::vector<token_t> tokenize(const lexer_table_t *, const lexer_input_t *);
 
+struct lexer_cache_stats {
+  std::atomic<std::size_t> hits{};
+  std::atomic<std::size_t> misses{};
+};
+
+inline double get_hit_rate(const lexer_cache_stats *s) {
+  const double hits = s->hits, all = hits + s->misses;
+  return all ? hits / all : 0;
+}
+
+struct lexer_cache_state;
+
+// Remembers the tokens arguments were classified into, including the
+// flags of lists like -bme, keyed by the table, the argument and the mode
+// it was classified in. It is bounded, evicting the least recently used
+// arguments, and can be shared by threads. Tables are told apart by
+// address and fingerprint, so a table changed in place misses instead of
+// getting the tokens of its former entries.
+struct lexer_cache {
+  explicit lexer_cache(std::size_t capacity = 1 << 16);
+  lexer_cache(const lexer_cache &) = delete;
+  lexer_cache &operator=(const lexer_cache &) = delete;
+  ~lexer_cache();
+
+  std::unique_ptr<lexer_cache_state> state{};
+  lexer_cache_stats stats{};
+};
+
+void clear(lexer_cache *);
+
+struct tokenize_info {
+  // Threads large inputs are split across, 0 for one per core; the tokens
+  // do not depend on it
+  std::size_t threads{1};
+  // Opt-in cache of classified arguments
+  lexer_cache *cache{};
+};
+
+// Classifies with the automaton compiled from the table, which gives the
+// same tokens as matching the patterns one after another
+std::vector<token_t> tokenize(const lexer_table_t *, const lexer_automaton *,
+                              const lexer_input_t *,
+                              const tokenize_info * = nullptr);
+
+// Writes references into the table and the input instead of copies; the
+// vector is cleared first, so reusing it saves the allocations; with an
+// automaton without fallback entries and enough capacity, tokenizing on
+// one thread allocates nothing
+void tokenize(const lexer_table_t *, const lexer_automaton *,
+              const lexer_input_t *, std::vector<token_ref> *,
+              const tokenize_info * = nullptr);
+
+struct scanner_info {
+  // Whitespace separates tokens instead of being matched by entries
+  bool skip_space{true};
+  // The longest token; the stream scanner buffers twice as much
+  std::size_t max_token{1 << 16};
+};
+
+using token_sink_t = std::function<void(token_t &&)>;
+
+// Maximal munch over a byte stream: every token is the longest prefix of
+// the remaining input an entry matches, the first such entry giving its
+// id; a byte no entry starts with becomes a token without an id. Tokens
+// are handed to the sink as they are found. Fails with format_error when
+// the automaton has fallback entries, which cannot take part.
+result scan(const lexer_table_t *, const lexer_automaton *, std::string_view,
+            const token_sink_t &, const scanner_info * = nullptr);
+result scan(const lexer_table_t *, const lexer_automaton *, std::istream *,
+            const token_sink_t &, const scanner_info * = nullptr);
+// Scans a regular file through a shared memory mapping, and pipes and
+// other files that cannot be mapped as a stream
+result scan_file(const lexer_table_t *, const lexer_automaton *,
+                 const std::string &path, const token_sink_t &,
+                 const scanner_info * = nullptr);
+
+// The same, handing references to the sink instead of owning tokens: the
+// id views the table and the value the input, which for a stream is the
+// scanner's window and only valid during the call. Over a buffer or a
+// mapped file nothing is copied.
+using token_ref_sink_t = std::function<void(const token_ref &)>;
+
+result scan(const lexer_table_t *, const lexer_automaton *, std::string_view,
+            const token_ref_sink_t &, const scanner_info * = nullptr);
+result scan(const lexer_table_t *, const lexer_automaton *, std::istream *,
+            const token_ref_sink_t &, const scanner_info * = nullptr);
+result scan_file(const lexer_table_t *, const lexer_automaton *,
+                 const std::string &path, const token_ref_sink_t &,
+                 const scanner_info * = nullptr);
+
 inline void add_entry(lexer_table_t *tbl, const token_type &t,
                       const std::string &id, const std::string &rgx) {
   tbl->push_back({t, id, rgx});
@@ -32,7 +200,24 @@ inline void add_entry(lexer_table_t *tbl, const token_type &t,
 
 result read_from_file(const std::string &src, lexer_table_t *dest);
 
+// Version of the binary format written by write_to_file(lexer_automaton)
+inline constexpr std::uint32_t compiled_lexer_version{1};
+
+// Writes the entries and the automaton compiled from them to a binary
+// file; fails with format_error when the automaton has fallback entries,
+// which could only be matched by compiling their patterns again.
+result write_to_file(const std::string &path, const lexer_table_t *,
+                     const lexer_automaton *);
+// Loads both from a shared mapping of the file without compiling any
+// pattern; the entries are uncompiled, so the table is meant to be used
+// with the automaton, without which tokenize compiles the patterns and
+// scan fails.
+result read_from_file(const std::string &path, lexer_table_t *,
+                      lexer_automaton *);
+
 std::string to_string(const lexer_table_t *);
+// Empty when the table has entries the automaton does not cover
+std::string to_string(const lexer_table_t *, const lexer_encoding *);
 } // namespace cfg
 
 std::ostream &operator<<(std::ostream &o, const cfg::token_type &t);
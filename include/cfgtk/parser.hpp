@@ -2,10 +2,16 @@
 
 #include <cfgtk/common.hpp>
 #include <cfgtk/filter.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace cfg {
@@ -23,12 +29,89 @@ struct cpp_encoding {
   bool namespace_on{true};
 };
 
+// Emits a standalone, grammar-specialized CYK recognizer for a CNF grammar;
+// the generated code does not depend on cfgtk.
+struct cyk_encoding {
+  std::string namespace_name{"cyk"};
+  bool include_guard{true};
+};
+
 struct rule {
   symbol_t lhs{};
   std::vector<symbol_t> rhs{};
 };
 using grammar_t = std::vector<std::unique_ptr<rule>>;
 
+// Interned, pointer-free representation of a CNF grammar; symbols are
+// referenced by their offset into a single string blob so the tables can
+// live in constant or memory-mapped storage.
+using symbol_id_t = std::uint32_t;
+
+struct compiled_symbol {
+  std::uint32_t offset{};
+  std::uint32_t size{};
+};
+
+struct compiled_rule {
+  symbol_id_t lhs{};
+  std::uint32_t size{};
+  symbol_id_t rhs[2]{};
+};
+
+struct grammar_view {
+  std::string_view strings{};
+  std::span<const compiled_symbol> symbols{};
+  // Symbol ids sorted by name, used to look up token ids
+  std::span<const symbol_id_t> by_name{};
+  // Rules in grammar order
+  std::span<const compiled_rule> rules{};
+  // Rules sorted by (size, rhs[0], rhs[1]), used to match right hand sides
+  std::span<const compiled_rule> index{};
+  symbol_id_t start{};
+};
+
+inline constexpr symbol_id_t no_symbol{static_cast<symbol_id_t>(-1)};
+
+// Version of the binary format written by write_to_file(grammar_view)
+inline constexpr std::uint32_t compiled_grammar_version{1};
+
+// Owns the storage behind a grammar_view: either tables built in memory by
+// compile, or a shared mapping of a binary file loaded by read_from_file.
+struct compiled_grammar {
+  compiled_grammar() = default;
+  compiled_grammar(const compiled_grammar &) = delete;
+  compiled_grammar &operator=(const compiled_grammar &) = delete;
+  compiled_grammar(compiled_grammar &&) = default;
+  compiled_grammar &operator=(compiled_grammar &&) = default;
+
+  grammar_view view{};
+  std::vector<char> strings{};
+  std::vector<compiled_symbol> symbols{};
+  std::vector<symbol_id_t> by_name{};
+  std::vector<compiled_rule> rules{};
+  std::vector<compiled_rule> index{};
+  // Keeps the mapping of a loaded file alive
+  std::shared_ptr<const void> mapping{};
+};
+
+inline constexpr std::string_view get_symbol(const grammar_view *g,
+                                             symbol_id_t s) {
+  return g->strings.substr(g->symbols[s].offset, g->symbols[s].size);
+}
+
+inline constexpr symbol_id_t find_symbol(const grammar_view *g,
+                                         std::string_view s) {
+  if (!g)
+    return no_symbol;
+
+  const auto it = std::lower_bound(
+      g->by_name.begin(), g->by_name.end(), s,
+      [g](symbol_id_t a, std::string_view b) { return get_symbol(g, a) < b; });
+  if (it == g->by_name.end() || get_symbol(g, *it) != s)
+    return no_symbol;
+  return *it;
+}
+
 struct inclusive_range {
   std::size_t begin{};
   std::size_t end{};
@@ -105,6 +188,14 @@ using token_sequence_t = std::vector<token_t>;
 
 chart_t cyk(const grammar_t *, const token_sequence_t *,
             const action_map_t * = nullptr);
+// Parses the tokens a lexer refers to without copying them: the leaves
+// keep an empty value, and rule.tokens.begin is the index of their token
+chart_t cyk(const grammar_t *, const std::vector<token_ref> *,
+            const action_map_t * = nullptr);
+
+bool recognize(const grammar_view *, const token_sequence_t *);
+result to_grammar(const grammar_view *, grammar_t *);
+result compile(const grammar_t *, compiled_grammar *);
 
 enum class cnf_filter : unsigned {
   unique0 = 1 << 0,
@@ -118,7 +209,16 @@ enum class cnf_filter : unsigned {
   group = 1 << 8,
   random = 1 << 9,
   prune = 1 << 10,
-  reduce = 1 << 11
+  reduce = 1 << 11,
+  // Opt-in: one proxy per terminal instead of one per occurrence
+  share_term = 1 << 12,
+  // Opt-in: right hand sides with a common suffix share its binary chain,
+  // at the cost of the parallel bin pass
+  share_bin = 1 << 13,
+  // Opt-in: remove useless symbols before and after the conversion; a
+  // start symbol that derives nothing then fails it with match_failure
+  useless0 = 1 << 14,
+  useless1 = 1 << 15
 };
 
 inline constexpr cnf_filter operator|(cnf_filter a, cnf_filter b) {
@@ -131,15 +231,74 @@ inline constexpr cnf_filter operator&(cnf_filter a, cnf_filter b) {
                                  static_cast<unsigned>(b));
 }
 
+struct cnf_cache_stats {
+  std::atomic<std::size_t> hits{};
+  std::atomic<std::size_t> misses{};
+};
+
+// The passes of the conversion; cnf_info::passes can run them in any order
+enum class cnf_pass {
+  unique,
+  start,
+  term,
+  bin,
+  del,
+  unit,
+  reduce,
+  group,
+  useless
+};
+
+struct useless_report;
+
+struct cnf_pass_stats {
+  cnf_pass pass{};
+  std::chrono::nanoseconds time{};
+  std::size_t rules_in{};
+  std::size_t rules_out{};
+  std::size_t symbols_created{};
+};
+
+// One entry per pass run, in the order they ran
+struct cnf_stats {
+  std::vector<cnf_pass_stats> passes{};
+};
+
 struct cnf_info {
   cnf_filter filter{cnf_filter::unique0 | cnf_filter::start | cnf_filter::term |
                     cnf_filter::bin | cnf_filter::del | cnf_filter::unique1 |
                     cnf_filter::unit | cnf_filter::unique2 | cnf_filter::group |
                     cnf_filter::random | cnf_filter::prune |
                     cnf_filter::reduce};
+
+  // Opt-in directory of converted grammars keyed by the input grammar, the
+  // filter and the library version; ignored while cnf_filter::random is set.
+  // A call that asks for stats or useless always runs the passes, so that
+  // it reports them, and only stores its result.
+  std::string cache_dir{};
+  cnf_cache_stats *cache_stats{};
+
+  // When not empty, the passes to run in this order instead of the ones
+  // selected by filter; the option bits of filter still apply. A value
+  // outside cnf_pass fails the conversion with format_error.
+  std::vector<cnf_pass> passes{};
+  cnf_stats *stats{};
+  // Filled by the useless pass, see remove_useless
+  useless_report *useless{};
+
+  // Threads the term, bin and del passes split large grammars across, 0
+  // for one per core; the output does not depend on it.
+  std::size_t threads{1};
 };
 
 result to_cnf(const grammar_t *input, grammar_t *out, const cnf_info *);
+// Take the rules of the input over instead of copying them; the input is
+// left empty. The in-place variant replaces the grammar with its CNF. On
+// failure both leave the input as it was: the rules are copied instead
+// when a pass can fail after others changed them, that is for a useless
+// pass and for a del pass with no bin pass before it.
+result to_cnf(grammar_t &&input, grammar_t *out, const cnf_info *);
+result to_cnf(grammar_t *, const cnf_info *);
 
 template <typename G> inline symbol_t get_start(const G *grammar) {
   return grammar->front()->lhs;
@@ -149,7 +308,34 @@ bool is_valid(const chart_t *c, const symbol_t &start);
 bool is_valid(const chart_node *c, const symbol_t &start);
 bool is_equal(const grammar_t *g1, const grammar_t *g2);
 
+// The size |G| the cost of CYK scales with: the number of symbols over all
+// rules, left hand sides included
+std::size_t get_size(const grammar_t *);
+
+// Structural fingerprints, stable across processes and platforms. The
+// unordered mode treats a grammar as a multiset of rules.
+enum class hash_mode { ordered, unordered };
+
+struct grammar_hash {
+  hash_mode mode{hash_mode::ordered};
+  std::uint64_t value{};
+  std::size_t size{};
+};
+
+std::uint64_t get_hash(const rule *);
+grammar_hash get_hash(const grammar_t *, hash_mode = hash_mode::ordered);
+
+// Appends a rule; in the unordered mode rules can also be removed
+void add_rule(grammar_hash *, const rule *);
+result remove_rule(grammar_hash *, const rule *);
+
+// Equal fingerprints identify equal grammars up to a 2^-64 chance of a
+// collision; is_equal on the grammars themselves gives the exact answer.
+bool is_equal(const grammar_hash *, const grammar_hash *);
+bool is_equal(const grammar_t *g1, const grammar_t *g2, hash_mode);
+
 std::string to_string(const chart_t *);
+std::string to_string(const cnf_stats *);
 
 std::string to_string(const chart_node *, const token_sequence_t *,
                       const std::size_t vertical_spacing = 1,
@@ -162,9 +348,15 @@ std::string to_string(const rule *, const std::size_t padding,
 
 std::string to_string(const grammar_t *, const text_encoding *);
 std::string to_string(const grammar_t *, const cpp_encoding *);
+std::string to_string(const grammar_t *, const cyk_encoding *);
 std::string to_string(const std::vector<const rule *> *, const text_encoding *);
 
 std::vector<chart_node> get_trees(const chart_t *, const symbol_t &start);
 
+// Maps regular files; pipes and other special files are read as a stream
 result read_from_file(const std::string &path, grammar_t *);
+
+result write_to_file(const std::string &path, const grammar_view *);
+// The file has to be a regular file, since it is mapped
+result read_from_file(const std::string &path, compiled_grammar *);
 } // namespace cfg
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <cfgtk/parser.hpp>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compile-time grammars: a grammar written in the read_from_file format is
+// parsed and converted to CNF during constant evaluation, and the result is
+// stored in pointer-free tables that can be viewed through grammar_view.
+//
+//   static constexpr auto g = cfg::make_static_grammar<"s a b\n...">();
+//   const auto view = g.view();
+//   cfg::recognize(&view, &tokens);
+//
+// The compile-time pipeline always produces a complete CNF grammar: start,
+// term (one proxy per terminal), bin, del (nullable fixed point), unit
+// (unit closure), duplicate removal and pruning of useless symbols.
+namespace cfg {
+template <std::size_t N> struct fixed_string {
+  constexpr fixed_string(const char (&s)[N]) { std::copy_n(s, N, data); }
+  constexpr std::string_view view() const { return {data, N - 1}; }
+
+  char data[N]{};
+};
+
+template <std::size_t Chars, std::size_t Symbols, std::size_t Rules>
+struct static_grammar {
+  constexpr grammar_view view() const {
+    return {.strings = {strings, Chars},
+            .symbols = {symbols, Symbols},
+            .by_name = {by_name, Symbols},
+            .rules = {rules, Rules},
+            .index = {index, Rules},
+            .start = start};
+  }
+
+  char strings[Chars ? Chars : 1]{};
+  compiled_symbol symbols[Symbols ? Symbols : 1]{};
+  symbol_id_t by_name[Symbols ? Symbols : 1]{};
+  compiled_rule rules[Rules ? Rules : 1]{};
+  compiled_rule index[Rules ? Rules : 1]{};
+  symbol_id_t start{};
+};
+} // namespace cfg
+
+namespace cfg::detail {
+inline constexpr std::size_t npos{static_cast<std::size_t>(-1)};
+
+struct ct_rule {
+  std::size_t lhs{};
+  std::vector<std::size_t> rhs{};
+
+  constexpr bool operator==(const ct_rule &) const = default;
+};
+
+struct ct_grammar {
+  constexpr std::size_t find(std::string_view s) const {
+    for (std::size_t i = 0; i < names.size(); ++i)
+      if (names[i] == s)
+        return i;
+    return npos;
+  }
+
+  constexpr std::size_t intern(std::string_view s) {
+    if (const auto i = find(s); i != npos)
+      return i;
+    names.emplace_back(s);
+    return names.size() - 1;
+  }
+
+  constexpr std::size_t fresh(std::string base) {
+    for (std::size_t k = 0;; ++k) {
+      std::string digits{};
+      for (auto v = k; !digits.size() || v; v /= 10)
+        digits.insert(digits.begin(), static_cast<char>('0' + v % 10));
+      if (auto id = base + "#" + digits; find(id) == npos) {
+        names.push_back(std::move(id));
+        return names.size() - 1;
+      }
+    }
+  }
+
+  constexpr std::vector<char> nonterms() const {
+    std::vector<char> nt(names.size(), 0);
+    for (const auto &r : rules)
+      nt[r.lhs] = 1;
+    return nt;
+  }
+
+  std::vector<std::string> names{};
+  std::vector<ct_rule> rules{};
+};
+
+constexpr std::string_view next_field(std::string_view &line) {
+  while (line.size() && line.front() == ' ')
+    line.remove_prefix(1);
+  const auto end = std::min(line.find(' '), line.size());
+  const auto field = line.substr(0, end);
+  line.remove_prefix(end);
+  return field;
+}
+
+constexpr result parse(std::string_view src, ct_grammar &g) {
+  while (src.size()) {
+    const auto eol = std::min(src.find('\n'), src.size());
+    auto line = src.substr(0, eol);
+    src.remove_prefix(std::min(eol + 1, src.size()));
+    if (!line.size())
+      continue;
+
+    const auto sp = std::min(line.find(' '), line.size());
+    ct_rule r{.lhs = g.intern(line.substr(0, sp))};
+    line.remove_prefix(sp);
+    while (line.size())
+      if (const auto f = next_field(line); f.size())
+        r.rhs.push_back(g.intern(f));
+    g.rules.push_back(std::move(r));
+  }
+  return g.rules.size() ? result::success : result::format_error;
+}
+
+constexpr void make_unique(ct_grammar &g) {
+  std::vector<ct_rule> out{};
+  for (auto &r : g.rules)
+    if (std::find(out.begin(), out.end(), r) == out.end())
+      out.push_back(std::move(r));
+  g.rules = std::move(out);
+}
+
+constexpr void to_cnf_start(ct_grammar &g) {
+  const auto start = g.rules.front().lhs;
+  for (const auto &r : g.rules)
+    if (std::find(r.rhs.begin(), r.rhs.end(), start) != r.rhs.end()) {
+      const auto s = g.fresh(g.names[start]);
+      g.rules.insert(g.rules.begin(), ct_rule{s, {start}});
+      return;
+    }
+}
+
+constexpr void to_cnf_term(ct_grammar &g) {
+  const auto nt = g.nonterms();
+  std::vector<std::size_t> proxy(g.names.size(), npos);
+  const auto count = g.rules.size();
+
+  for (std::size_t i = 0; i < count; ++i) {
+    if (g.rules[i].rhs.size() < 2)
+      continue;
+    for (std::size_t j = 0; j < g.rules[i].rhs.size(); ++j) {
+      const auto s = g.rules[i].rhs[j];
+      if (nt[s])
+        continue;
+      if (proxy[s] == npos) {
+        proxy[s] = g.fresh(g.names[s]);
+        g.rules.push_back({proxy[s], {s}});
+      }
+      g.rules[i].rhs[j] = proxy[s];
+    }
+  }
+}
+
+constexpr void to_cnf_bin(ct_grammar &g) {
+  const auto count = g.rules.size();
+  for (std::size_t i = 0; i < count; ++i) {
+    if (g.rules[i].rhs.size() < 3)
+      continue;
+
+    const auto rhs = g.rules[i].rhs;
+    auto link = g.fresh(g.names[g.rules[i].lhs]);
+    g.rules[i].rhs = {rhs[0], link};
+    for (std::size_t j = 1; j + 2 < rhs.size(); ++j) {
+      const auto next = g.fresh(g.names[link]);
+      g.rules.push_back({link, {rhs[j], next}});
+      link = next;
+    }
+    g.rules.push_back({link, {rhs[rhs.size() - 2], rhs.back()}});
+  }
+}
+
+constexpr std::vector<char> get_nullable(const ct_grammar &g) {
+  std::vector<char> nullable(g.names.size(), 0);
+  for (bool changed{true}; changed;) {
+    changed = false;
+    for (const auto &r : g.rules)
+      if (!nullable[r.lhs] &&
+          std::all_of(r.rhs.begin(), r.rhs.end(),
+                      [&nullable](auto s) { return nullable[s]; })) {
+        nullable[r.lhs] = 1;
+        changed = true;
+      }
+  }
+  return nullable;
+}
+
+constexpr void to_cnf_del(ct_grammar &g) {
+  const auto nullable = get_nullable(g);
+  const auto start = g.rules.front().lhs;
+  std::vector<ct_rule> out{};
+
+  for (const auto &r : g.rules) {
+    if (r.rhs.size())
+      out.push_back(r);
+    if (r.rhs.size() == 2) {
+      if (nullable[r.rhs.front()])
+        out.push_back({r.lhs, {r.rhs.back()}});
+      if (nullable[r.rhs.back()])
+        out.push_back({r.lhs, {r.rhs.front()}});
+    }
+  }
+
+  if (nullable[start]) {
+    auto pos = std::find_if(out.begin(), out.end(),
+                            [start](const auto &r) { return r.lhs == start; });
+    out.insert(pos == out.end() ? out.begin() : ++pos, ct_rule{start, {}});
+  }
+  g.rules = std::move(out);
+}
+
+constexpr void to_cnf_unit(ct_grammar &g, const std::vector<char> &nt) {
+  const auto is_unit = [&nt](const ct_rule &r) {
+    return r.rhs.size() == 1 && nt[r.rhs.front()];
+  };
+
+  std::vector<std::size_t> order{};
+  for (const auto &r : g.rules)
+    if (std::find(order.begin(), order.end(), r.lhs) == order.end())
+      order.push_back(r.lhs);
+
+  std::vector<ct_rule> out{};
+  for (const auto a : order) {
+    // Every nonterminal reachable from a through unit rules, a included
+    std::vector<std::size_t> closure{a};
+    for (std::size_t i = 0; i < closure.size(); ++i)
+      for (const auto &r : g.rules)
+        if (r.lhs == closure[i] && is_unit(r) &&
+            std::find(closure.begin(), closure.end(), r.rhs.front()) ==
+                closure.end())
+          closure.push_back(r.rhs.front());
+
+    for (const auto b : closure)
+      for (const auto &r : g.rules)
+        if (r.lhs == b && !is_unit(r))
+          out.push_back({a, r.rhs});
+  }
+  g.rules = std::move(out);
+}
+
+// Drops rules that reference non-productive symbols, then rules whose
+// left hand side cannot be reached from the start symbol.
+constexpr void prune(ct_grammar &g, const std::vector<char> &nt,
+                     std::size_t start) {
+  std::vector<char> productive(g.names.size(), 0);
+  for (std::size_t s = 0; s < nt.size(); ++s)
+    productive[s] = !nt[s];
+
+  for (bool changed{true}; changed;) {
+    changed = false;
+    for (const auto &r : g.rules)
+      if (!productive[r.lhs] &&
+          std::all_of(r.rhs.begin(), r.rhs.end(),
+                      [&productive](auto s) { return productive[s]; })) {
+        productive[r.lhs] = 1;
+        changed = true;
+      }
+  }
+  std::erase_if(g.rules, [&productive](const ct_rule &r) {
+    return std::any_of(r.rhs.begin(), r.rhs.end(),
+                       [&productive](auto s) { return !productive[s]; });
+  });
+
+  std::vector<char> reachable(g.names.size(), 0);
+  reachable[start] = 1;
+  for (bool changed{true}; changed;) {
+    changed = false;
+    for (const auto &r : g.rules)
+      if (reachable[r.lhs])
+        for (const auto s : r.rhs)
+          if (!reachable[s]) {
+            reachable[s] = 1;
+            changed = true;
+          }
+  }
+  std::erase_if(g.rules,
+                [&reachable](const ct_rule &r) { return !reachable[r.lhs]; });
+}
+
+struct ct_result {
+  ct_grammar grammar{};
+  std::size_t start{};
+  result status{};
+};
+
+// Runs the whole pipeline and renumbers the surviving symbols so that
+// the start symbol comes first, followed by symbols in order of appearance.
+constexpr ct_result convert(std::string_view src) {
+  ct_result out{};
+  ct_grammar g{};
+  if ((out.status = parse(src, g)) != result::success)
+    return out;
+
+  make_unique(g);
+  to_cnf_start(g);
+  const auto start = g.rules.front().lhs;
+  to_cnf_term(g);
+  to_cnf_bin(g);
+
+  // Symbols whose only rules are empty lose them in del but remain
+  // nonterminals, so the set is taken before that pass.
+  const auto nt = g.nonterms();
+  to_cnf_del(g);
+  to_cnf_unit(g, nt);
+  make_unique(g);
+  prune(g, nt, start);
+
+  std::vector<std::size_t> id(g.names.size(), npos);
+  const auto renumber = [&out, &id, &g](std::size_t s) {
+    if (id[s] == npos) {
+      id[s] = out.grammar.names.size();
+      out.grammar.names.push_back(g.names[s]);
+    }
+    return id[s];
+  };
+
+  out.start = renumber(start);
+  for (const auto &r : g.rules) {
+    ct_rule n{.lhs = renumber(r.lhs)};
+    for (const auto s : r.rhs)
+      n.rhs.push_back(renumber(s));
+    out.grammar.rules.push_back(std::move(n));
+  }
+  return out;
+}
+
+struct ct_sizes {
+  std::size_t chars{}, symbols{}, rules{};
+  result status{};
+};
+
+constexpr ct_sizes measure(std::string_view src) {
+  const auto c = convert(src);
+  ct_sizes s{.symbols = c.grammar.names.size(),
+             .rules = c.grammar.rules.size(),
+             .status = c.status};
+  for (const auto &n : c.grammar.names)
+    s.chars += n.size();
+  return s;
+}
+
+template <typename G> constexpr void fill(std::string_view src, G &out) {
+  const auto c = convert(src);
+  const auto &g = c.grammar;
+
+  std::uint32_t offset{};
+  for (std::size_t i = 0; i < g.names.size(); ++i) {
+    std::copy(g.names[i].begin(), g.names[i].end(), out.strings + offset);
+    out.symbols[i] = {offset, static_cast<std::uint32_t>(g.names[i].size())};
+    out.by_name[i] = static_cast<symbol_id_t>(i);
+    offset += static_cast<std::uint32_t>(g.names[i].size());
+  }
+  std::sort(out.by_name, out.by_name + g.names.size(),
+            [&g](symbol_id_t a, symbol_id_t b) {
+              return g.names[a] < g.names[b];
+            });
+
+  for (std::size_t i = 0; i < g.rules.size(); ++i) {
+    compiled_rule r{.lhs = static_cast<symbol_id_t>(g.rules[i].lhs),
+                    .size = static_cast<std::uint32_t>(g.rules[i].rhs.size())};
+    for (std::size_t j = 0; j < g.rules[i].rhs.size(); ++j)
+      r.rhs[j] = static_cast<symbol_id_t>(g.rules[i].rhs[j]);
+    out.rules[i] = out.index[i] = r;
+  }
+  std::sort(out.index, out.index + g.rules.size(),
+            [](const auto &a, const auto &b) {
+              if (a.size != b.size)
+                return a.size < b.size;
+              if (a.rhs[0] != b.rhs[0])
+                return a.rhs[0] < b.rhs[0];
+              if (a.rhs[1] != b.rhs[1])
+                return a.rhs[1] < b.rhs[1];
+              return a.lhs < b.lhs;
+            });
+  out.start = static_cast<symbol_id_t>(c.start);
+}
+} // namespace cfg::detail
+
+namespace cfg {
+template <fixed_string Source> consteval auto make_static_grammar() {
+  constexpr auto s = detail::measure(Source.view());
+  static_assert(s.status == result::success,
+                "the grammar source does not contain any rule");
+  static_grammar<s.chars, s.symbols, s.rules> g{};
+  detail::fill(Source.view(), g);
+  return g;
+}
+} // namespace cfg
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cfgtk/parser.hpp>
+#include <string>
+#include <string_view>
+
+namespace cfg {
+// The bytes write_to_file stores for a compiled grammar
+std::string to_image(const grammar_view *);
+
+// Points the view into an image, which has to start 8-byte aligned and
+// outlive the view; only checks bounds and never allocates
+result to_view(std::string_view image, grammar_view *);
+} // namespace cfg
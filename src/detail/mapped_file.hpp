@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cfgtk/common.hpp>
+#include <fcntl.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cfg {
+// Only regular, non-empty files are mapped; pipes, character devices and
+// files such as those under /proc report no size, so they and empty files
+// have to be read as a stream instead.
+enum class map_status { mapped, unmappable, failed };
+
+// A read-only, shared memory mapping of a whole file; the pages are shared
+// between every process that maps the same file.
+class mapped_file {
+public:
+  mapped_file() = default;
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  mapped_file(mapped_file &&o) noexcept { *this = std::move(o); }
+
+  mapped_file &operator=(mapped_file &&o) noexcept {
+    if (this != &o) {
+      unmap();
+      addr = o.addr;
+      size = o.size;
+      o.addr = nullptr;
+      o.size = 0;
+    }
+    return *this;
+  }
+
+  ~mapped_file() { unmap(); }
+
+  std::string_view view() const {
+    return {static_cast<const char *>(addr), size};
+  }
+
+  friend map_status map_file(const std::string &, mapped_file *);
+
+private:
+  void unmap() {
+    if (addr)
+      ::munmap(addr, size);
+    addr = nullptr;
+    size = 0;
+  }
+
+  void *addr{};
+  std::size_t size{};
+};
+
+inline map_status map_file(const std::string &path, mapped_file *m) {
+  // Checked before opening, since opening a pipe waits for its writer
+  struct stat st {};
+  if (::stat(path.c_str(), &st) != 0)
+    return map_status::failed;
+  if (!S_ISREG(st.st_mode) || st.st_size <= 0)
+    return map_status::unmappable;
+
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return map_status::failed;
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    ::close(fd);
+    return map_status::unmappable;
+  }
+
+  mapped_file out{};
+  out.size = static_cast<std::size_t>(st.st_size);
+  out.addr = ::mmap(nullptr, out.size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (out.addr == MAP_FAILED) {
+    out.addr = nullptr;
+    out.size = 0;
+    return map_status::failed;
+  }
+
+  if (m)
+    *m = std::move(out);
+  return map_status::mapped;
+}
+} // namespace cfg
@@ -0,0 +1,614 @@
+#include <cfgtk/lexer.hpp>
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <limits>
+#include <map>
+#include <optional>
+
+namespace {
+using byte_set = std::bitset<256>;
+
+constexpr std::uint32_t no_state{std::numeric_limits<std::uint32_t>::max()};
+constexpr std::size_t max_copies{256};
+constexpr std::size_t max_dfa_states{1 << 16};
+
+struct nfa_state {
+  // Bytes leading to next
+  byte_set bytes{};
+  std::uint32_t next{no_state};
+  std::vector<std::uint32_t> epsilon{};
+};
+
+// A piece of a Thompson automaton; end has no transitions yet
+struct fragment {
+  std::uint32_t begin{};
+  std::uint32_t end{};
+};
+
+struct nfa {
+  std::vector<nfa_state> states{};
+
+  std::uint32_t add() {
+    states.emplace_back();
+    return static_cast<std::uint32_t>(states.size() - 1);
+  }
+
+  fragment empty() {
+    const auto s = add();
+    return {s, s};
+  }
+
+  fragment bytes(const byte_set &b) {
+    const auto s = add(), t = add();
+    states[s].bytes = b;
+    states[s].next = t;
+    return {s, t};
+  }
+
+  fragment join(fragment a, fragment b) {
+    states[a.end].epsilon.push_back(b.begin);
+    return {a.begin, b.end};
+  }
+
+  fragment either(fragment a, fragment b) {
+    const auto s = add(), t = add();
+    states[s].epsilon = {a.begin, b.begin};
+    states[a.end].epsilon.push_back(t);
+    states[b.end].epsilon.push_back(t);
+    return {s, t};
+  }
+
+  fragment star(fragment a) {
+    const auto s = add(), t = add();
+    states[s].epsilon = {a.begin, t};
+    states[a.end].epsilon = {a.begin, t};
+    return {s, t};
+  }
+
+  fragment optional(fragment a) {
+    const auto s = add(), t = add();
+    states[s].epsilon = {a.begin, t};
+    states[a.end].epsilon.push_back(t);
+    return {s, t};
+  }
+};
+
+byte_set make_range(unsigned char lo, unsigned char hi) {
+  byte_set b{};
+  for (unsigned c = lo; c <= hi; ++c)
+    b.set(c);
+  return b;
+}
+
+byte_set make_byte(unsigned char c) { return make_range(c, c); }
+
+// The ECMAScript subset std::regex_match patterns in lexer tables use:
+// literals, escapes, classes, groups, alternation and quantifiers, with ^
+// and $ at the ends of the pattern. Anything else, like back references,
+// assertions or POSIX classes, fails the parse and the entry keeps using
+// its std::regex.
+class regex_parser {
+public:
+  regex_parser(std::string_view p, nfa *n) : pattern{p}, out{n} {}
+
+  std::optional<fragment> parse() {
+    end = pattern.size();
+    if (end && pattern.front() == '^')
+      ++pos;
+    if (end > pos && pattern[end - 1] == '$' && !is_escaped(end - 1))
+      --end;
+
+    const auto f = alternation();
+    if (failed || pos != end)
+      return std::nullopt;
+    return f;
+  }
+
+private:
+  bool is_escaped(std::size_t i) const {
+    std::size_t slashes{};
+    while (i > slashes && pattern[i - slashes - 1] == '\\')
+      ++slashes;
+    return slashes % 2;
+  }
+
+  bool more() const { return !failed && pos < end; }
+
+  fragment fail() {
+    failed = true;
+    return out->empty();
+  }
+
+  fragment alternation() {
+    auto f = sequence();
+    while (more() && pattern[pos] == '|') {
+      ++pos;
+      f = out->either(f, sequence());
+    }
+    return f;
+  }
+
+  fragment sequence() {
+    auto f = out->empty();
+    while (more() && pattern[pos] != '|' && pattern[pos] != ')')
+      f = out->join(f, repetition());
+    return f;
+  }
+
+  std::optional<std::size_t> number() {
+    std::size_t n{}, digits{};
+    for (; pos < end && std::isdigit(static_cast<unsigned char>(pattern[pos]));
+         ++pos, ++digits)
+      if ((n = n * 10 + static_cast<std::size_t>(pattern[pos] - '0')) >
+          max_copies)
+        return std::nullopt;
+    if (!digits)
+      return std::nullopt;
+    return n;
+  }
+
+  fragment repetition() {
+    const auto begin = pos;
+    auto f = atom();
+    if (!more())
+      return f;
+
+    std::size_t lo{}, hi{};
+    bool bounded{true};
+    switch (pattern[pos++]) {
+    case '*':
+      bounded = false;
+      break;
+    case '+':
+      lo = 1;
+      bounded = false;
+      break;
+    case '?':
+      hi = 1;
+      break;
+    case '{': {
+      const auto n = number();
+      if (!n || pos >= end)
+        return fail();
+      lo = hi = *n;
+      if (pattern[pos] == ',') {
+        ++pos;
+        if (pos < end && pattern[pos] == '}')
+          bounded = false;
+        else if (const auto m = number(); m && *m >= lo)
+          hi = *m;
+        else
+          return fail();
+      }
+      if (pos >= end || pattern[pos++] != '}')
+        return fail();
+      break;
+    }
+    default:
+      --pos;
+      return f;
+    }
+    if (pos < end && pattern[pos] == '?')
+      ++pos;
+    if (more() && std::string_view{"*+?{"}.find(pattern[pos]) !=
+                      std::string_view::npos)
+      return fail();
+
+    // Further copies of the atom are parsed again from its text
+    const auto copy = [this, begin] {
+      const auto resume = pos;
+      pos = begin;
+      const auto f = atom();
+      pos = resume;
+      return f;
+    };
+
+    if (lo + (bounded ? hi - lo : 1) > max_copies)
+      return fail();
+    auto r = lo ? f : out->empty();
+    for (std::size_t i = 1; i < lo; ++i)
+      r = out->join(r, copy());
+    if (!bounded)
+      return out->join(r, out->star(lo ? copy() : f));
+    for (std::size_t i = lo; i < hi; ++i)
+      r = out->join(r, out->optional(i || lo ? copy() : f));
+    return r;
+  }
+
+  fragment atom() {
+    if (!more())
+      return fail();
+
+    const auto c = pattern[pos++];
+    switch (c) {
+    case '(': {
+      if (pos < end && pattern[pos] == '?') {
+        if (pos + 1 >= end || pattern[pos + 1] != ':')
+          return fail();
+        pos += 2;
+      }
+      const auto f = alternation();
+      if (pos >= end || pattern[pos++] != ')')
+        return fail();
+      return f;
+    }
+    case '[':
+      return out->bytes(set());
+    case '.':
+      return out->bytes(~(make_byte('\n') | make_byte('\r')));
+    case '\\': {
+      const auto b = escape(false);
+      return failed ? fail() : out->bytes(b);
+    }
+    case '^':
+    case '$':
+    case ')':
+    case ']':
+    case '{':
+    case '}':
+    case '*':
+    case '+':
+    case '?':
+    case '|':
+      return fail();
+    default:
+      return out->bytes(make_byte(static_cast<unsigned char>(c)));
+    }
+  }
+
+  byte_set escape(bool in_set) {
+    if (pos >= end) {
+      failed = true;
+      return {};
+    }
+
+    const auto c = pattern[pos++];
+    const auto digit = make_range('0', '9');
+    const auto word = make_range('a', 'z') | make_range('A', 'Z') | digit |
+                      make_byte('_');
+    const auto space = make_range('\t', '\r') | make_byte(' ');
+    switch (c) {
+    case 'd':
+      return digit;
+    case 'D':
+      return ~digit;
+    case 'w':
+      return word;
+    case 'W':
+      return ~word;
+    case 's':
+      return space;
+    case 'S':
+      return ~space;
+    case 'n':
+      return make_byte('\n');
+    case 't':
+      return make_byte('\t');
+    case 'r':
+      return make_byte('\r');
+    case 'f':
+      return make_byte('\f');
+    case 'v':
+      return make_byte('\v');
+    case 'b':
+      if (in_set)
+        return make_byte('\b');
+      break;
+    case '0':
+      if (pos >= end || !std::isdigit(static_cast<unsigned char>(pattern[pos])))
+        return make_byte('\0');
+      break;
+    case 'x':
+      if (pos + 2 <= end &&
+          std::isxdigit(static_cast<unsigned char>(pattern[pos])) &&
+          std::isxdigit(static_cast<unsigned char>(pattern[pos + 1]))) {
+        const auto b = std::stoul(std::string{pattern.substr(pos, 2)}, nullptr,
+                                  16);
+        pos += 2;
+        if (b < 0x80)
+          return make_byte(static_cast<unsigned char>(b));
+      }
+      break;
+    default:
+      if (!std::isalnum(static_cast<unsigned char>(c)))
+        return make_byte(static_cast<unsigned char>(c));
+    }
+    failed = true;
+    return {};
+  }
+
+  // A single byte of a class, for the ends of ranges
+  std::optional<unsigned char> set_byte() {
+    const auto c = pattern[pos];
+    if (c != '\\') {
+      ++pos;
+      return static_cast<unsigned char>(c);
+    }
+    ++pos;
+    const auto b = escape(true);
+    if (failed || b.count() != 1)
+      return std::nullopt;
+    for (unsigned i = 0; i < b.size(); ++i)
+      if (b.test(i))
+        return static_cast<unsigned char>(i);
+    return std::nullopt;
+  }
+
+  byte_set set() {
+    byte_set b{};
+    const bool negated = pos < end && pattern[pos] == '^';
+    if (negated)
+      ++pos;
+    if (pos < end && pattern[pos] == ']') {
+      failed = true;
+      return b;
+    }
+
+    while (more() && pattern[pos] != ']') {
+      if (pattern[pos] == '[') {
+        failed = true;
+        return b;
+      }
+      if (pattern[pos] == '\\' && pos + 1 < end &&
+          std::string_view{"dDwWsS"}.find(pattern[pos + 1]) !=
+              std::string_view::npos) {
+        ++pos;
+        b |= escape(true);
+        continue;
+      }
+
+      const auto lo = set_byte();
+      if (!lo) {
+        failed = true;
+        return b;
+      }
+      if (pos + 1 < end && pattern[pos] == '-' && pattern[pos + 1] != ']') {
+        ++pos;
+        const auto hi = set_byte();
+        if (!hi || *hi < *lo || *hi >= 0x80) {
+          failed = true;
+          return b;
+        }
+        b |= make_range(*lo, *hi);
+      } else
+        b.set(*lo);
+    }
+    if (pos >= end || failed) {
+      failed = true;
+      return b;
+    }
+    ++pos;
+    return negated ? ~b : b;
+  }
+
+  std::string_view pattern{};
+  nfa *out{};
+  std::size_t pos{};
+  std::size_t end{};
+  bool failed{};
+};
+
+// Bytes no pattern tells apart share a class
+std::uint32_t make_classes(const nfa &n, std::array<std::uint8_t, 256> *cls) {
+  std::array<std::uint32_t, 256> ids{};
+  std::uint32_t count{1};
+  std::vector<const byte_set *> seen{};
+  for (const auto &s : n.states) {
+    if (s.next == no_state ||
+        std::any_of(seen.begin(), seen.end(),
+                    [&s](const auto *b) { return *b == s.bytes; }))
+      continue;
+    seen.push_back(&s.bytes);
+
+    std::map<std::pair<std::uint32_t, bool>, std::uint32_t> split{};
+    for (unsigned c = 0; c < ids.size(); ++c)
+      ids[c] = split.try_emplace({ids[c], s.bytes.test(c)},
+                                 static_cast<std::uint32_t>(split.size()))
+                   .first->second;
+    count = static_cast<std::uint32_t>(split.size());
+  }
+
+  for (unsigned c = 0; c < ids.size(); ++c)
+    (*cls)[c] = static_cast<std::uint8_t>(ids[c]);
+  return count;
+}
+
+void close(const nfa &n, std::vector<std::uint32_t> *set) {
+  std::vector<bool> in(n.states.size());
+  std::vector<std::uint32_t> stack{*set};
+  set->clear();
+  while (!stack.empty()) {
+    const auto s = stack.back();
+    stack.pop_back();
+    if (in[s])
+      continue;
+    in[s] = true;
+    set->push_back(s);
+    stack.insert(stack.end(), n.states[s].epsilon.begin(),
+                 n.states[s].epsilon.end());
+  }
+  std::sort(set->begin(), set->end());
+}
+
+// Merges the states no input tells apart, by refining the partition
+// given by the accepting entries until it is stable
+void minimize(cfg::lexer_automaton *a,
+              const std::vector<std::vector<std::uint32_t>> &accepts) {
+  const auto states = accepts.size();
+  const auto k = a->class_count;
+  std::vector<std::uint32_t> block(states);
+  std::size_t count{};
+  {
+    std::map<std::vector<std::uint32_t>, std::uint32_t> ids{};
+    for (std::size_t s = 0; s < states; ++s)
+      block[s] = ids.try_emplace(accepts[s], static_cast<std::uint32_t>(
+                                                 ids.size()))
+                     .first->second;
+    count = ids.size();
+  }
+
+  for (;;) {
+    std::map<std::vector<std::uint32_t>, std::uint32_t> ids{};
+    std::vector<std::uint32_t> next(states);
+    for (std::size_t s = 0; s < states; ++s) {
+      std::vector<std::uint32_t> signature{block[s]};
+      for (std::uint32_t c = 0; c < k; ++c)
+        signature.push_back(block[a->transitions[s * k + c]]);
+      next[s] = ids.try_emplace(std::move(signature),
+                                static_cast<std::uint32_t>(ids.size()))
+                    .first->second;
+    }
+    block = std::move(next);
+    if (ids.size() == count)
+      break;
+    count = ids.size();
+  }
+
+  std::vector<std::uint32_t> transitions(count * k);
+  std::vector<const std::vector<std::uint32_t> *> accepted(count);
+  for (std::size_t s = 0; s < states; ++s) {
+    accepted[block[s]] = &accepts[s];
+    for (std::uint32_t c = 0; c < k; ++c)
+      transitions[block[s] * k + c] = block[a->transitions[s * k + c]];
+  }
+
+  a->transitions = std::move(transitions);
+  a->start = block[a->start];
+  a->reject = block[a->reject];
+  a->accept_offsets = {0};
+  a->accepts.clear();
+  for (const auto *list : accepted) {
+    a->accepts.insert(a->accepts.end(), list->begin(), list->end());
+    a->accept_offsets.push_back(static_cast<std::uint32_t>(a->accepts.size()));
+  }
+}
+
+// Only sizes are checked, in constant time; compile and read_from_file
+// check every transition of the automata they make
+bool is_well_formed(const cfg::lexer_automaton *a) {
+  if (!a->class_count || a->accept_offsets.size() < 2)
+    return false;
+  const auto states = a->accept_offsets.size() - 1;
+  return a->transitions.size() == states * a->class_count &&
+         a->start < states && a->reject < states &&
+         a->accept_offsets.back() == a->accepts.size();
+}
+} // namespace
+
+namespace cfg {
+result compile(const lexer_table_t *tbl, lexer_automaton *out) {
+  if (!tbl || !out)
+    return result::format_error;
+
+  lexer_automaton a{};
+  a.entries = tbl->size();
+  a.fingerprint = get_fingerprint(tbl);
+
+  nfa n{};
+  const auto root = n.add();
+  // The entry each final state of the automaton accepts
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> finals{};
+  for (std::size_t i = 0; i < tbl->size(); ++i) {
+    const auto mark = n.states.size();
+    const auto f = regex_parser{(*tbl)[i].regex, &n}.parse();
+    if (!f) {
+      n.states.resize(mark);
+      a.fallback.push_back(static_cast<std::uint32_t>(i));
+      continue;
+    }
+    n.states[root].epsilon.push_back(f->begin);
+    finals.emplace_back(f->end, static_cast<std::uint32_t>(i));
+  }
+  std::vector<std::uint32_t> final_entry(n.states.size(), no_state);
+  for (const auto &[s, e] : finals)
+    final_entry[s] = std::min(final_entry[s], e);
+
+  a.class_count = make_classes(n, &a.classes);
+  std::vector<std::uint8_t> sample(a.class_count);
+  for (unsigned c = 256; c-- > 0;)
+    sample[a.classes[c]] = static_cast<std::uint8_t>(c);
+
+  // Subset construction; state 0 is the empty set, which rejects
+  std::map<std::vector<std::uint32_t>, std::uint32_t> ids{{{}, 0}};
+  std::vector<std::vector<std::uint32_t>> sets{{}}, accepts{{}};
+  std::vector<std::uint32_t> initial{root};
+  close(n, &initial);
+  ids.emplace(initial, 1);
+  sets.push_back(std::move(initial));
+  accepts.emplace_back();
+  a.start = 1;
+
+  for (std::size_t d = 0; d < sets.size(); ++d) {
+    for (const auto s : sets[d])
+      if (final_entry[s] != no_state)
+        accepts[d].push_back(final_entry[s]);
+    std::sort(accepts[d].begin(), accepts[d].end());
+    accepts[d].erase(std::unique(accepts[d].begin(), accepts[d].end()),
+                     accepts[d].end());
+
+    for (std::uint32_t c = 0; c < a.class_count; ++c) {
+      std::vector<std::uint32_t> next{};
+      for (const auto s : sets[d])
+        if (n.states[s].next != no_state && n.states[s].bytes.test(sample[c]))
+          next.push_back(n.states[s].next);
+      close(n, &next);
+
+      auto [it, inserted] =
+          ids.try_emplace(next, static_cast<std::uint32_t>(sets.size()));
+      if (inserted) {
+        if (sets.size() == max_dfa_states)
+          return result::excessive_symbols;
+        sets.push_back(std::move(next));
+        accepts.emplace_back();
+      }
+      a.transitions.push_back(it->second);
+    }
+  }
+
+  minimize(&a, accepts);
+  *out = std::move(a);
+  return result::success;
+}
+
+std::uint64_t get_fingerprint(const lexer_table_t *tbl) {
+  std::uint64_t h{0xcbf29ce484222325};
+  const auto add = [&h](std::string_view s) {
+    for (const auto c : s) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 0x100000001b3;
+    }
+    // Separates the strings, so that "ab" "c" differs from "a" "bc"
+    h ^= s.size();
+    h *= 0x100000001b3;
+  };
+  for (const auto &e : *tbl) {
+    h ^= static_cast<std::uint64_t>(e.type);
+    h *= 0x100000001b3;
+    add(e.id);
+    add(e.regex);
+  }
+  return h;
+}
+
+bool is_compiled_from(const lexer_automaton *a, const lexer_table_t *tbl) {
+  return a && tbl && is_well_formed(a) && a->entries == tbl->size() &&
+         a->fingerprint == get_fingerprint(tbl);
+}
+
+std::span<const std::uint32_t> get_matches(const lexer_automaton *a,
+                                           std::string_view s) {
+  if (!a || !is_well_formed(a))
+    return {};
+
+  auto state = a->start;
+  for (const auto c : s) {
+    state = a->transitions[state * a->class_count +
+                           a->classes[static_cast<unsigned char>(c)]];
+    if (state == a->reject)
+      return {};
+  }
+  return {a->accepts.data() + a->accept_offsets[state],
+          a->accepts.data() + a->accept_offsets[state + 1]};
+}
+} // namespace cfg
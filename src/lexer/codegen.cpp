@@ -0,0 +1,305 @@
+#include <cfgtk/lexer.hpp>
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace {
+// Words an id cannot be turned into without clashing with the language
+const std::set<std::string> keywords{
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor",
+    "bool", "break", "case", "catch", "char", "char8_t", "char16_t", "char32_t",
+    "class", "compl", "concept", "const", "consteval", "constexpr", "constinit",
+    "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype",
+    "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+    "explicit", "export", "extern", "false", "float", "for", "friend", "goto",
+    "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+    "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private",
+    "protected", "public", "register", "reinterpret_cast", "requires", "return",
+    "short", "signed", "sizeof", "static", "static_assert", "static_cast",
+    "struct", "switch", "template", "this", "thread_local", "throw", "true",
+    "try", "typedef", "typeid", "typename", "union", "unsigned", "using",
+    "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"};
+
+struct lexer_tables {
+  // The distinct ids in table order, after the empty one of unmatched tokens
+  std::vector<cfg::symbol_t> ids{{}};
+  std::vector<std::string> names{"none"};
+  // The index into ids of every entry
+  std::vector<std::size_t> entry_ids{};
+};
+
+// The contents of a string literal spelling s; other bytes than printable
+// ASCII are written as octal escapes, which end after three digits
+std::string escape(const std::string &s) {
+  std::string out{};
+  for (const auto c : s) {
+    const auto u = static_cast<unsigned char>(c);
+    if (u < 0x20 || u > 0x7e) {
+      const char octal[]{'\\', char('0' + (u >> 6)),
+                         char('0' + ((u >> 3) & 7)), char('0' + (u & 7))};
+      out.append(octal, sizeof(octal));
+      continue;
+    }
+    if (c == '"' || c == '\\')
+      out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+// An identifier for the id, made unique among the names taken so far
+std::string make_name(const std::string &id,
+                      const std::vector<std::string> &taken) {
+  std::string out{};
+  for (const auto c : id)
+    out += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  if (out.empty() || std::isdigit(static_cast<unsigned char>(out[0])))
+    out = "t_" + out;
+
+  while (keywords.contains(out) ||
+         std::find(taken.begin(), taken.end(), out) != taken.end())
+    out += '_';
+  return out;
+}
+
+lexer_tables make_tables(const cfg::lexer_table_t *tbl) {
+  lexer_tables t{};
+  for (const auto &e : *tbl) {
+    const auto it = std::find(t.ids.begin() + 1, t.ids.end(), e.id);
+    t.entry_ids.push_back(static_cast<std::size_t>(it - t.ids.begin()));
+    if (it != t.ids.end())
+      continue;
+    t.names.push_back(make_name(e.id, t.names));
+    t.ids.push_back(e.id);
+  }
+  return t;
+}
+
+void emit_prologue(std::stringstream &o, const lexer_tables &t,
+                   const cfg::lexer_table_t *tbl,
+                   const cfg::lexer_encoding *e) {
+  if (e->include_guard)
+    o << "#pragma once\n\n";
+
+  o << "#include <array>\n"
+       "#include <cstddef>\n"
+       "#include <cstdint>\n"
+       "#include <iterator>\n"
+       "#include <string_view>\n"
+       "#include <vector>\n\n";
+
+  o << "namespace " << e->namespace_name << " {\n";
+  o << "enum class token_id : std::uint32_t {\n";
+  for (const auto &n : t.names)
+    o << "  " << n << ",\n";
+  o << "};\n\n";
+
+  o << "inline constexpr std::string_view names[]{\n";
+  for (const auto &id : t.ids)
+    o << "    \"" << escape(id) << "\",\n";
+  o << "};\n\n";
+
+  o << "enum class token_type : std::uint8_t { option, flag, free };\n\n";
+
+  o << "struct token {\n"
+       "  token_id id{};\n"
+       "  std::string_view value{};\n"
+       "};\n\n";
+
+  o << "inline constexpr std::size_t entry_count{" << tbl->size() << "};\n";
+  o << "inline constexpr std::uint32_t no_entry{static_cast<std::uint32_t>("
+       "-1)};\n";
+  o << "inline constexpr token_id entry_ids[entry_count ? entry_count : 1]{";
+  for (std::size_t i = 0; i < t.entry_ids.size(); ++i)
+    o << (i ? ", " : "") << "token_id::" << t.names[t.entry_ids[i]];
+  o << "};\n\n";
+}
+
+void emit_transitions(std::stringstream &o, const cfg::lexer_automaton *a) {
+  o << "inline constexpr std::uint32_t start_state{" << a->start << "};\n";
+  o << "inline constexpr std::uint32_t reject_state{" << a->reject
+    << "};\n\n";
+
+  // Bytes going the same way share a class, which the switches are over
+  o << "inline constexpr std::uint8_t classes[256]{";
+  for (std::size_t c = 0; c < a->classes.size(); ++c)
+    o << (c % 16 ? " " : "\n    ") << unsigned{a->classes[c]} << ",";
+  o << "\n};\n\n";
+
+  o << "inline std::uint32_t step(std::uint32_t state, unsigned char c) {\n"
+       "  switch (state) {\n";
+  const auto states = a->transitions.size() / a->class_count;
+  for (std::uint32_t s = 0; s < states; ++s) {
+    if (s == a->reject)
+      continue;
+
+    std::map<std::uint32_t, std::vector<std::uint32_t>> targets{};
+    for (std::uint32_t c = 0; c < a->class_count; ++c)
+      if (const auto to = a->transitions[s * a->class_count + c];
+          to != a->reject)
+        targets[to].push_back(c);
+    if (targets.empty())
+      continue;
+
+    o << "  case " << s << ":\n"
+      << "    switch (classes[c]) {\n";
+    for (const auto &[to, classes] : targets) {
+      for (const auto c : classes)
+        o << "    case " << c << ":\n";
+      o << "      return " << to << ";\n";
+    }
+    o << "    default:\n"
+         "      return reject_state;\n"
+         "    }\n";
+  }
+  o << "  default:\n"
+       "    return reject_state;\n"
+       "  }\n"
+       "}\n\n";
+}
+
+void emit_accepts(std::stringstream &o, const cfg::lexer_table_t *tbl,
+                  const cfg::lexer_automaton *a) {
+  constexpr std::string_view types[]{"option", "flag", "free"};
+
+  o << "// The first entry of a type whose pattern matches the whole text\n"
+       "inline std::uint32_t first_match(std::string_view s, token_type t) "
+       "{\n"
+       "  auto state = start_state;\n"
+       "  for (const auto c : s)\n"
+       "    if ((state = step(state, static_cast<unsigned char>(c))) ==\n"
+       "        reject_state)\n"
+       "      return no_entry;\n\n"
+       "  switch (state) {\n";
+  for (std::uint32_t s = 0; s + 1 < a->accept_offsets.size(); ++s) {
+    const auto begin = a->accept_offsets[s], end = a->accept_offsets[s + 1];
+    if (begin == end)
+      continue;
+
+    o << "  case " << s << ":\n";
+    std::set<cfg::token_type> seen{};
+    for (auto i = begin; i < end; ++i) {
+      const auto entry = a->accepts[i];
+      if (!seen.insert((*tbl)[entry].type).second)
+        continue;
+      o << "    if (t == token_type::"
+        << types[static_cast<std::size_t>((*tbl)[entry].type)] << ")\n"
+        << "      return " << entry << ";\n";
+    }
+    o << "    break;\n";
+  }
+  o << "  default:\n"
+       "    break;\n"
+       "  }\n"
+       "  return no_entry;\n"
+       "}\n\n";
+}
+
+// The same modes as cfg::tokenize: --x and -c are single ids, -abc a list
+// of flags that may end with an option, -- forces the next argument to be
+// free, and anything else is free
+void emit_tokenizer(std::stringstream &o) {
+  o << "inline token make_token(std::uint32_t e, std::string_view value) {\n"
+       "  return {e == no_entry ? token_id::none : entry_ids[e], value};\n"
+       "}\n\n";
+
+  o << "inline std::string_view flag_text(char c) {\n"
+       "  static constexpr auto texts = [] {\n"
+       "    std::array<std::array<char, 2>, 256> out{};\n"
+       "    for (std::size_t i = 0; i < out.size(); ++i)\n"
+       "      out[i] = {'-', static_cast<char>(i)};\n"
+       "    return out;\n"
+       "  }();\n"
+       "  return {texts[static_cast<unsigned char>(c)].data(), 2};\n"
+       "}\n\n";
+
+  o << "inline bool tokenize_single_id(std::string_view s,\n"
+       "                               std::vector<token> *out) {\n"
+       "  auto e = first_match(s, token_type::option);\n"
+       "  if (e == no_entry)\n"
+       "    e = first_match(s, token_type::flag);\n"
+       "  if (e == no_entry)\n"
+       "    return false;\n"
+       "  out->push_back(make_token(e, s));\n"
+       "  return true;\n"
+       "}\n\n";
+
+  o << "inline bool tokenize_id_list(std::string_view s,\n"
+       "                             std::vector<token> *out) {\n"
+       "  const auto size = out->size();\n"
+       "  for (std::size_t i = 1; i < s.size(); ++i) {\n"
+       "    const auto f = flag_text(s[i]);\n"
+       "    const auto opt = first_match(f, token_type::option);\n"
+       "    if (const auto e = first_match(f, token_type::flag); e != "
+       "no_entry)\n"
+       "      out->push_back(make_token(e, f));\n"
+       "    else if (i == s.size() - 1 && opt != no_entry)\n"
+       "      out->push_back(make_token(opt, s.substr(i, 1)));\n"
+       "    else {\n"
+       "      out->resize(size);\n"
+       "      return false;\n"
+       "    }\n"
+       "  }\n"
+       "  return true;\n"
+       "}\n\n";
+
+  o << "inline void tokenize_free(std::string_view s, std::vector<token> "
+       "*out) {\n"
+       "  out->push_back(make_token(first_match(s, token_type::free), s));\n"
+       "}\n\n";
+
+  o << "// Clears the output and fills it with views into the input\n"
+       "template <typename Sequence>\n"
+       "void tokenize(const Sequence &in, std::vector<token> *out) {\n"
+       "  out->clear();\n"
+       "  const std::size_t n = std::size(in);\n"
+       "  for (std::size_t i = 0; i < n; ++i) {\n"
+       "    const std::string_view s{in[i]};\n"
+       "    if (s.size() < 2 || s[0] != '-' || s[1] == ' ') {\n"
+       "      tokenize_free(s, out);\n"
+       "      continue;\n"
+       "    }\n\n"
+       "    if (s == \"--\") {\n"
+       "      if (++i < n)\n"
+       "        tokenize_free(in[i], out);\n"
+       "      continue;\n"
+       "    }\n\n"
+       "    const bool single = s[1] == '-' || s.size() == 2;\n"
+       "    if (single ? !tokenize_single_id(s, out) : "
+       "!tokenize_id_list(s, out))\n"
+       "      tokenize_free(s, out);\n"
+       "  }\n"
+       "}\n\n";
+
+  o << "template <typename Sequence>\n"
+       "std::vector<token> tokenize(const Sequence &in) {\n"
+       "  std::vector<token> out{};\n"
+       "  tokenize(in, &out);\n"
+       "  return out;\n"
+       "}\n";
+}
+} // namespace
+
+namespace cfg {
+std::string to_string(const lexer_table_t *tbl, const lexer_encoding *e) {
+  if (!tbl || !e || !e->namespace_name.size())
+    return {};
+
+  lexer_automaton a{};
+  if (compile(tbl, &a) != result::success || a.fallback.size())
+    return {};
+
+  const auto tables = make_tables(tbl);
+  std::stringstream out{};
+
+  emit_prologue(out, tables, tbl, e);
+  emit_transitions(out, &a);
+  emit_accepts(out, tbl, &a);
+  emit_tokenizer(out);
+  out << "} // namespace " << e->namespace_name;
+
+  return out.str();
+}
+} // namespace cfg
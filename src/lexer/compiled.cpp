@@ -0,0 +1,231 @@
+#include <cfgtk/lexer.hpp>
+#include <detail/mapped_file.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace {
+// Every section starts at a multiple of this, so the loaded tables can be
+// copied out of the mapping as they are
+constexpr std::uint64_t section_alignment{8};
+constexpr char file_magic[8]{'C', 'F', 'G', 'T', 'K', 'L', 'X', '\0'};
+constexpr std::uint32_t byte_order_mark{0x01020304};
+
+struct file_header {
+  char magic[8]{};
+  std::uint32_t version{};
+  std::uint32_t byte_order{};
+  std::uint32_t entry_count{};
+  std::uint32_t class_count{};
+  std::uint32_t state_count{};
+  std::uint32_t accept_count{};
+  std::uint32_t start{};
+  std::uint32_t reject{};
+  std::uint32_t string_size{};
+  std::uint32_t reserved{};
+  std::uint64_t entries{};
+  std::uint64_t classes{};
+  std::uint64_t transitions{};
+  std::uint64_t accept_offsets{};
+  std::uint64_t accepts{};
+  std::uint64_t strings{};
+};
+
+// The id and the pattern source of an entry are consecutive strings
+struct file_entry {
+  std::uint32_t type{};
+  std::uint32_t offset{};
+  std::uint32_t id_size{};
+  std::uint32_t regex_size{};
+};
+static_assert(std::is_trivially_copyable_v<file_header>);
+static_assert(std::is_trivially_copyable_v<file_entry>);
+
+std::uint64_t align(std::uint64_t offset) {
+  return (offset + section_alignment - 1) / section_alignment *
+         section_alignment;
+}
+
+template <typename T>
+const T *section(std::string_view file, std::uint64_t offset,
+                 std::uint64_t count) {
+  if (offset % alignof(T) || offset > file.size() ||
+      count > (file.size() - offset) / sizeof(T))
+    return nullptr;
+  return reinterpret_cast<const T *>(file.data() + offset);
+}
+
+template <typename T>
+std::vector<T> copy_section(const T *data, std::uint64_t count) {
+  return std::vector<T>(data, data + count);
+}
+
+// Checks that every state, class, entry and string a table refers to
+// exists, so that tokenizing with the loaded automaton stays in bounds
+bool is_consistent(const file_header &h, const file_entry *entries,
+                   const std::uint8_t *classes,
+                   const std::uint32_t *transitions,
+                   const std::uint32_t *accept_offsets,
+                   const std::uint32_t *accepts) {
+  if (!h.class_count || h.class_count > 256 || h.start >= h.state_count ||
+      h.reject >= h.state_count)
+    return false;
+
+  for (std::uint32_t i = 0; i < h.entry_count; ++i) {
+    const auto &e = entries[i];
+    if (e.type > static_cast<std::uint32_t>(cfg::token_type::free) ||
+        e.offset > h.string_size ||
+        std::uint64_t{e.id_size} + e.regex_size > h.string_size - e.offset)
+      return false;
+  }
+
+  for (std::size_t c = 0; c < 256; ++c)
+    if (classes[c] >= h.class_count)
+      return false;
+  for (std::uint64_t i = 0; i < std::uint64_t{h.state_count} * h.class_count;
+       ++i)
+    if (transitions[i] >= h.state_count)
+      return false;
+
+  if (accept_offsets[0] || accept_offsets[h.state_count] != h.accept_count)
+    return false;
+  for (std::uint32_t s = 0; s < h.state_count; ++s)
+    if (accept_offsets[s] > accept_offsets[s + 1])
+      return false;
+  for (std::uint32_t i = 0; i < h.accept_count; ++i)
+    if (accepts[i] >= h.entry_count)
+      return false;
+  // The first accept of a state is taken as its first match, so the
+  // accepts of each state strictly ascend
+  for (std::uint32_t s = 0; s < h.state_count; ++s)
+    for (auto i = accept_offsets[s] + 1; i < accept_offsets[s + 1]; ++i)
+      if (accepts[i - 1] >= accepts[i])
+        return false;
+  return true;
+}
+} // namespace
+
+namespace cfg {
+result write_to_file(const std::string &path, const lexer_table_t *tbl,
+                     const lexer_automaton *a) {
+  if (!is_compiled_from(a, tbl) || a->fallback.size())
+    return result::format_error;
+
+  std::string strings{};
+  std::vector<file_entry> entries{};
+  for (const auto &e : *tbl) {
+    entries.push_back({.type = static_cast<std::uint32_t>(e.type),
+                       .offset = static_cast<std::uint32_t>(strings.size()),
+                       .id_size = static_cast<std::uint32_t>(e.id.size()),
+                       .regex_size =
+                           static_cast<std::uint32_t>(e.regex.size())});
+    strings += e.id;
+    strings += e.regex;
+  }
+
+  file_header h{};
+  std::copy(std::begin(file_magic), std::end(file_magic), h.magic);
+  h.version = compiled_lexer_version;
+  h.byte_order = byte_order_mark;
+  h.entry_count = static_cast<std::uint32_t>(entries.size());
+  h.class_count = a->class_count;
+  h.state_count =
+      static_cast<std::uint32_t>(a->transitions.size() / a->class_count);
+  h.accept_count = static_cast<std::uint32_t>(a->accepts.size());
+  h.start = a->start;
+  h.reject = a->reject;
+  h.string_size = static_cast<std::uint32_t>(strings.size());
+  h.entries = align(sizeof(file_header));
+  h.classes = align(h.entries + entries.size() * sizeof(file_entry));
+  h.transitions = align(h.classes + a->classes.size());
+  h.accept_offsets = align(h.transitions + a->transitions.size() *
+                                               sizeof(std::uint32_t));
+  h.accepts = align(h.accept_offsets +
+                    a->accept_offsets.size() * sizeof(std::uint32_t));
+  h.strings = align(h.accepts + a->accepts.size() * sizeof(std::uint32_t));
+
+  std::string data(h.strings + strings.size(), '\0');
+  const auto put = [&data](std::uint64_t offset, const auto *src,
+                           std::size_t bytes) {
+    if (bytes)
+      std::memcpy(data.data() + offset, src, bytes);
+  };
+  put(0, &h, sizeof(h));
+  put(h.entries, entries.data(), entries.size() * sizeof(file_entry));
+  put(h.classes, a->classes.data(), a->classes.size());
+  put(h.transitions, a->transitions.data(),
+      a->transitions.size() * sizeof(std::uint32_t));
+  put(h.accept_offsets, a->accept_offsets.data(),
+      a->accept_offsets.size() * sizeof(std::uint32_t));
+  put(h.accepts, a->accepts.data(), a->accepts.size() * sizeof(std::uint32_t));
+  put(h.strings, strings.data(), strings.size());
+
+  std::ofstream str{path, std::ios::binary | std::ios::trunc};
+  if (!str.is_open())
+    return result::file_access_failure;
+  str.write(data.data(), static_cast<std::streamsize>(data.size()));
+  return str ? result::success : result::file_access_failure;
+}
+
+result read_from_file(const std::string &path, lexer_table_t *tbl,
+                      lexer_automaton *a) {
+  if (!tbl || !a)
+    return result::format_error;
+
+  mapped_file m{};
+  if (map_file(path, &m) != map_status::mapped)
+    return result::file_access_failure;
+
+  const auto file = m.view();
+  file_header h{};
+  if (file.size() < sizeof(h))
+    return result::format_error;
+  std::memcpy(&h, file.data(), sizeof(h));
+
+  if (!std::equal(std::begin(file_magic), std::end(file_magic), h.magic) ||
+      h.version != compiled_lexer_version || h.byte_order != byte_order_mark)
+    return result::format_error;
+
+  const auto *entries = section<file_entry>(file, h.entries, h.entry_count);
+  const auto *classes = section<std::uint8_t>(file, h.classes, 256);
+  const auto *transitions = section<std::uint32_t>(
+      file, h.transitions, std::uint64_t{h.state_count} * h.class_count);
+  const auto *accept_offsets = section<std::uint32_t>(
+      file, h.accept_offsets, std::uint64_t{h.state_count} + 1);
+  const auto *accepts = section<std::uint32_t>(file, h.accepts, h.accept_count);
+  const auto *strings = section<char>(file, h.strings, h.string_size);
+  if (!entries || !classes || !transitions || !accept_offsets || !accepts ||
+      !strings ||
+      !is_consistent(h, entries, classes, transitions, accept_offsets,
+                     accepts))
+    return result::format_error;
+
+  lexer_table_t t{};
+  t.reserve(h.entry_count);
+  for (std::uint32_t i = 0; i < h.entry_count; ++i) {
+    const auto &e = entries[i];
+    const std::string_view id{strings + e.offset, e.id_size};
+    const std::string_view regex{strings + e.offset + e.id_size, e.regex_size};
+    t.emplace_back(static_cast<token_type>(e.type), std::string{id},
+                   std::string{regex}, uncompiled);
+  }
+
+  lexer_automaton c{};
+  c.entries = h.entry_count;
+  c.fingerprint = get_fingerprint(&t);
+  std::copy(classes, classes + 256, c.classes.begin());
+  c.class_count = h.class_count;
+  c.start = h.start;
+  c.reject = h.reject;
+  c.transitions = copy_section(
+      transitions, std::uint64_t{h.state_count} * h.class_count);
+  c.accept_offsets =
+      copy_section(accept_offsets, std::uint64_t{h.state_count} + 1);
+  c.accepts = copy_section(accepts, h.accept_count);
+
+  *tbl = std::move(t);
+  *a = std::move(c);
+  return result::success;
+}
+} // namespace cfg
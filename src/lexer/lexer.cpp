@@ -1,36 +1,168 @@
 #include <cfgtk/lexer.hpp>
+#include <algorithm>
 #include <fstream>
 #include <list>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 
 namespace cfg {
 enum class lexer_mode { single_id, id_list, non_id, forced_non_id };
 
+// The first entry of each token type, indexed by token_type
+using first_entries_t = std::array<std::uint32_t, 3>;
+
+struct literal_hash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view s) const {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
+// The literal entries of a table by the strings they match, and the other
+// entries. The strings are copies, so the index of a table is told by its
+// contents alone and survives changes to the table.
+struct literal_index {
+  std::size_t entries{};
+  std::uint64_t fingerprint{};
+  bool built{};
+  std::unordered_map<std::string, first_entries_t, literal_hash,
+                     std::equal_to<>>
+      literals{};
+  // The literals of the form -c, by c
+  std::array<first_entries_t, 256> flags{};
+  // The entries that are not literal
+  std::vector<std::uint32_t> patterns{};
+  // The patterns of uncompiled entries, by entry, compiled here instead
+  std::vector<std::regex> deferred{};
+};
+
+// Finds the first entry of a type matching a string: with the automaton
+// when there is one, otherwise by looking literal entries up and matching
+// only the other patterns.
+struct lexer_matcher {
+  const lexer_automaton *dfa{};
+  const literal_index *index{};
+};
+
 struct lexer_context {
-  std::vector<token_t> token_sequence;
-  lexer_mode mode;
+  std::vector<token_ref> *token_sequence{};
+  lexer_mode mode{};
+  const lexer_matcher *matcher{};
+  lexer_cache *cache{};
+  // Of the table, which the cache keys are made with
+  std::uint64_t fingerprint{};
+};
+
+// A token of a cached argument, with its value as a part of the argument
+// or, for flags out of lists, as the flag text -c
+struct cached_token {
+  std::uint32_t entry{};
+  std::uint32_t offset{};
+  std::uint32_t size{};
+  std::int16_t flag{-1};
+};
+
+// A table is told by its address and its contents, so that one changed in
+// place does not get the tokens of its former entries
+struct cache_key {
+  const lexer_table_t *table{};
+  std::uint64_t fingerprint{};
+  std::string_view argument{};
+  lexer_mode mode{};
+
+  bool operator==(const cache_key &) const = default;
 };
+
+struct cache_key_hash {
+  std::size_t operator()(const cache_key &k) const {
+    const auto h = std::hash<std::string_view>{}(k.argument);
+    return h ^ (std::hash<const void *>{}(k.table) + k.fingerprint +
+                static_cast<std::size_t>(k.mode) + 0x9e3779b97f4a7c15 +
+                (h << 6) + (h >> 2));
+  }
+};
+
+struct cache_entry {
+  const lexer_table_t *table{};
+  std::uint64_t fingerprint{};
+  std::string argument{};
+  lexer_mode mode{};
+  std::vector<cached_token> tokens{};
+};
+
+// One of the independently locked parts of the cache, evicting its least
+// recently used entry when full; the keys view the arguments of the
+// entries, which list nodes keep in place
+struct cache_shard {
+  std::mutex mutex{};
+  std::list<cache_entry> entries{};
+  std::unordered_map<cache_key, std::list<cache_entry>::iterator,
+                     cache_key_hash>
+      index{};
+};
+
+struct lexer_cache_state {
+  static constexpr std::size_t shard_count{16};
+
+  std::size_t shard_capacity{};
+  std::array<cache_shard, shard_count> shards{};
+};
+
+lexer_cache::lexer_cache(std::size_t capacity)
+    : state{new lexer_cache_state{}} {
+  state->shard_capacity =
+      std::max<std::size_t>(1, capacity / lexer_cache_state::shard_count);
+}
+
+lexer_cache::~lexer_cache() = default;
+
+void clear(lexer_cache *c) {
+  for (auto &s : c->state->shards) {
+    std::lock_guard lock{s.mutex};
+    s.index.clear();
+    s.entries.clear();
+  }
+}
 } // namespace cfg
 
 namespace {
 cfg::lexer_mode detect_mode(const std::string &token);
-cfg::result tokenize_single_id(const cfg::lexer_table_t *, const std::string &,
-                               cfg::token_t *);
-cfg::result tokenize_id_list(const cfg::lexer_table_t *, const std::string &,
-                             std::vector<cfg::token_t> *&);
-cfg::result tokenize_flag(const cfg::lexer_table_t *, const std::string &,
-                          cfg::token_t *);
-cfg::result tokenize_flag(const cfg::lexer_table_t *, const char,
-                          cfg::token_t *);
+cfg::result tokenize_single_id(const cfg::lexer_table_t *,
+                               const cfg::lexer_matcher *,
+                               const std::string &, cfg::token_ref *);
+cfg::result tokenize_id_list(const cfg::lexer_table_t *,
+                             const cfg::lexer_matcher *, const std::string &,
+                             std::vector<cfg::token_ref> *);
+cfg::result tokenize_flag(const cfg::lexer_table_t *,
+                          const cfg::lexer_matcher *, std::string_view,
+                          cfg::token_ref *);
+cfg::result tokenize_flag(const cfg::lexer_table_t *,
+                          const cfg::lexer_matcher *, const char,
+                          cfg::token_ref *);
+std::string_view flag_text(char c);
+std::uint32_t first_match(const cfg::lexer_table_t *,
+                          const cfg::lexer_matcher *, std::string_view,
+                          cfg::token_type);
 } // namespace
 
 namespace {
+cfg::token_ref make_token(const cfg::lexer_table_t *tbl, std::uint32_t entry,
+                          std::string_view value) {
+  return {.entry = entry,
+          .id = entry != cfg::no_token_entry ? (*tbl)[entry].id
+                                             : std::string_view{},
+          .value = value};
+}
+
 cfg::result handle_single_id(const cfg::lexer_table_t *tbl,
                              const std::string &inp, cfg::lexer_context &ctx) {
-  cfg::token_t tok{};
+  cfg::token_ref tok{};
   if (ctx.mode == cfg::lexer_mode::single_id) {
-    if (tokenize_single_id(tbl, inp, &tok) == cfg::result::success) {
-      ctx.token_sequence.push_back(std::move(tok));
+    if (tokenize_single_id(tbl, ctx.matcher, inp, &tok) ==
+        cfg::result::success) {
+      ctx.token_sequence->push_back(tok);
       return cfg::result::success;
     }
   }
@@ -40,8 +172,8 @@ cfg::result handle_single_id(const cfg::lexer_table_t *tbl,
 cfg::result handle_id_list(const cfg::lexer_table_t *tbl,
                            const std::string &inp, cfg::lexer_context &ctx) {
   if (ctx.mode == cfg::lexer_mode::id_list) {
-    std::vector<cfg::token_t> *tseq = &ctx.token_sequence;
-    if (tokenize_id_list(tbl, inp, tseq) == cfg::result::success)
+    if (tokenize_id_list(tbl, ctx.matcher, inp, ctx.token_sequence) ==
+        cfg::result::success)
       return cfg::result::success;
   }
 
@@ -50,45 +182,277 @@ cfg::result handle_id_list(const cfg::lexer_table_t *tbl,
 
 void handle_non_id(const cfg::lexer_table_t *tbl, const std::string &val,
                    cfg::lexer_context &ctx) {
-  std::string id{};
-
   // Since at this point the val string is not an option and not a flag,
   // we check if it matches a custom regex,
   // if not, then we simply insert an empty token_id with the value
-  for (const auto &e : *tbl) {
-    if (e.type != cfg::token_type::option && e.type != cfg::token_type::flag &&
-        std::regex_match(val, e.pattern)) {
-      id = e.id;
-      break;
+  const auto e = first_match(tbl, ctx.matcher, val, cfg::token_type::free);
+  ctx.token_sequence->push_back(make_token(tbl, e, val));
+}
+
+void index_literals(const cfg::lexer_table_t *tbl, cfg::literal_index *x) {
+  x->literals.clear();
+  x->patterns.clear();
+  x->deferred.clear();
+  for (auto &f : x->flags)
+    f.fill(cfg::no_token_entry);
+
+  for (std::uint32_t i = 0; i < tbl->size(); ++i) {
+    const auto &e = (*tbl)[i];
+    if (!e.literal) {
+      x->patterns.push_back(i);
+      if (!e.compiled) {
+        x->deferred.resize(tbl->size());
+        x->deferred[i] = std::regex{e.regex};
+      }
+      continue;
+    }
+
+    const auto type = static_cast<std::size_t>(e.type);
+    for (const auto &s : e.literals) {
+      auto &first =
+          s.size() == 2 && s[0] == '-'
+              ? x->flags[static_cast<unsigned char>(s[1])]
+              : x->literals
+                    .try_emplace(s, cfg::first_entries_t{cfg::no_token_entry,
+                                                         cfg::no_token_entry,
+                                                         cfg::no_token_entry})
+                    .first->second;
+      first[type] = std::min(first[type], i);
     }
   }
+}
+
+// The same table is mostly tokenized again and again, so each thread keeps
+// the index of the last table it tokenized without an automaton and only
+// builds it again when the contents differ
+const cfg::literal_index *get_index(const cfg::lexer_table_t *tbl) {
+  static thread_local cfg::literal_index last{};
+  const auto fingerprint = cfg::get_fingerprint(tbl);
+  // The fingerprint leaves out whether the patterns were compiled
+  const auto deferred = std::ranges::any_of(
+      *tbl, [](const auto &e) { return !e.compiled && !e.literal; });
+  if (!last.built || last.entries != tbl->size() ||
+      last.fingerprint != fingerprint ||
+      (deferred && last.deferred.empty())) {
+    index_literals(tbl, &last);
+    last.entries = tbl->size();
+    last.fingerprint = fingerprint;
+    last.built = true;
+  }
+  return &last;
+}
+
+// Arguments below this many per thread are not worth splitting
+constexpr std::size_t min_chunk{4096};
+
+std::size_t get_chunks(std::size_t size, std::size_t threads) {
+  return std::max<std::size_t>(1, std::min(threads, size / min_chunk));
+}
+
+// The bounds of roughly equal chunks of the input, each moved past the
+// argument a -- right before it forces to be free, so that every chunk
+// is tokenized as it would be in one piece. Of a run of --, the first
+// forces the second and so on, so a bound splits a pair when the run
+// ending before it is odd.
+std::vector<std::size_t> get_bounds(const cfg::lexer_input_t *inp,
+                                    std::size_t chunks) {
+  std::vector<std::size_t> out{0};
+  for (std::size_t c = 1; c < chunks; ++c) {
+    auto b = std::max(out.back(), inp->size() * c / chunks);
+    std::size_t run{};
+    while (run < b && (*inp)[b - run - 1] == "--")
+      ++run;
+    if (run % 2)
+      ++b;
+    if (b > out.back() && b < inp->size())
+      out.push_back(b);
+  }
+  out.push_back(inp->size());
+  return out;
+}
+
+// Calls f(chunk) for every chunk; the first runs on the calling thread
+template <typename F> void parallel_for(std::size_t chunks, const F &f) {
+  std::vector<std::jthread> pool{};
+  pool.reserve(chunks - 1);
+  for (std::size_t c = 1; c < chunks; ++c)
+    pool.emplace_back([&f, c] { f(c); });
+  f(0);
+}
+
+void classify(const cfg::lexer_table_t *tbl, const std::string &arg,
+              cfg::lexer_context &ctx) {
+  if (handle_single_id(tbl, arg, ctx) == cfg::result::success)
+    return;
+
+  if (handle_id_list(tbl, arg, ctx) == cfg::result::success)
+    return;
 
-  ctx.token_sequence.push_back({id, val});
+  handle_non_id(tbl, arg, ctx);
+}
+
+cfg::cache_shard &get_shard(cfg::lexer_cache *c, std::size_t hash) {
+  return c->state->shards[hash % cfg::lexer_cache_state::shard_count];
+}
+
+// Appends the tokens cached for the key, if there are any
+bool find_cached(const cfg::cache_key &k, std::size_t hash,
+                 cfg::lexer_context &ctx) {
+  auto &s = get_shard(ctx.cache, hash);
+  std::lock_guard lock{s.mutex};
+  const auto it = s.index.find(k);
+  if (it == s.index.end())
+    return false;
+
+  s.entries.splice(s.entries.begin(), s.entries, it->second);
+  for (const auto &c : it->second->tokens)
+    ctx.token_sequence->push_back(make_token(
+        k.table, c.entry,
+        c.flag < 0 ? k.argument.substr(c.offset, c.size)
+                   : flag_text(static_cast<char>(c.flag))));
+  return true;
+}
+
+void add_cached(const cfg::cache_key &k, std::size_t hash,
+                std::span<const cfg::token_ref> tokens,
+                cfg::lexer_context &ctx) {
+  cfg::cache_entry e{k.table, k.fingerprint, std::string{k.argument}, k.mode,
+                     {}};
+  for (const auto &t : tokens) {
+    auto &c = e.tokens.emplace_back();
+    c.entry = t.entry;
+    if (t.value.data() >= k.argument.data() &&
+        t.value.data() <= k.argument.data() + k.argument.size()) {
+      c.offset = static_cast<std::uint32_t>(t.value.data() -
+                                            k.argument.data());
+      c.size = static_cast<std::uint32_t>(t.value.size());
+    } else
+      c.flag = static_cast<unsigned char>(t.value[1]);
+  }
+
+  auto &s = get_shard(ctx.cache, hash);
+  std::lock_guard lock{s.mutex};
+  if (s.index.contains(k))
+    return;
+  if (s.entries.size() >= ctx.cache->state->shard_capacity) {
+    const auto &last = s.entries.back();
+    s.index.erase({last.table, last.fingerprint, last.argument, last.mode});
+    s.entries.pop_back();
+  }
+  s.entries.push_front(std::move(e));
+  const auto &first = s.entries.front();
+  s.index.emplace(cfg::cache_key{first.table, first.fingerprint,
+                                 first.argument, first.mode},
+                  s.entries.begin());
+}
+
+// Classifies through the cache: an argument seen before in the same mode
+// gets the tokens it had then
+void classify_cached(const cfg::lexer_table_t *tbl, const std::string &arg,
+                     cfg::lexer_context &ctx) {
+  const cfg::cache_key k{tbl, ctx.fingerprint, arg, ctx.mode};
+  const auto hash = cfg::cache_key_hash{}(k);
+  if (find_cached(k, hash, ctx)) {
+    ++ctx.cache->stats.hits;
+    return;
+  }
+
+  ++ctx.cache->stats.misses;
+  const auto size = ctx.token_sequence->size();
+  classify(tbl, arg, ctx);
+  add_cached(k, hash, std::span{*ctx.token_sequence}.subspan(size), ctx);
+}
+
+void tokenize_chunk(const cfg::lexer_table_t *tbl,
+                    const cfg::lexer_matcher *m, cfg::lexer_cache *cache,
+                    const cfg::lexer_input_t *inp, std::size_t begin,
+                    std::size_t end, std::vector<cfg::token_ref> *out) {
+  cfg::lexer_context ctx{};
+  ctx.token_sequence = out;
+  ctx.matcher = m;
+  ctx.cache = cache;
+  if (cache)
+    ctx.fingerprint = cfg::get_fingerprint(tbl);
+
+  for (std::size_t i = begin; i < end; ++i) {
+    ctx.mode = detect_mode((*inp)[i]);
+
+    // The argument after -- is free whatever it looks like
+    if (ctx.mode == cfg::lexer_mode::forced_non_id) {
+      if (++i == end)
+        break;
+      ctx.mode = cfg::lexer_mode::non_id;
+    }
+
+    if (cache)
+      classify_cached(tbl, (*inp)[i], ctx);
+    else
+      classify(tbl, (*inp)[i], ctx);
+  }
 }
 } // namespace
 
 namespace cfg {
 std::vector<token_t> tokenize(const lexer_table_t *tbl,
                               const lexer_input_t *inp) {
-  lexer_context ctx{};
-
-  for (std::size_t i = 0; i < inp->size(); ++i) {
-		ctx.mode = detect_mode((*inp)[i]);
-
-		if (handle_single_id(tbl, (*inp)[i], ctx) == result::success)
-			continue;
-
-                if (handle_id_list(tbl, (*inp)[i], ctx) == result::success)
-                  continue;
+  return tokenize(tbl, nullptr, inp);
+}
 
-		if (ctx.mode == lexer_mode::forced_non_id)
-			++i;
+std::vector<token_t> tokenize(const lexer_table_t *tbl,
+                              const lexer_automaton *dfa,
+                              const lexer_input_t *inp,
+                              const tokenize_info *info) {
+  std::vector<token_ref> refs{};
+  tokenize(tbl, dfa, inp, &refs, info);
+
+  std::vector<token_t> out{};
+  out.reserve(refs.size());
+  for (const auto &t : refs)
+    out.push_back({symbol_t{t.id}, std::string{t.value}});
+  return out;
+}
 
-    if (i < inp->size())
-      handle_non_id(tbl, (*inp)[i], ctx);
+void tokenize(const lexer_table_t *tbl, const lexer_automaton *dfa,
+              const lexer_input_t *inp, std::vector<token_ref> *out,
+              const tokenize_info *info) {
+  out->clear();
+  lexer_matcher m{};
+  if (is_compiled_from(dfa, tbl)) {
+    m.dfa = dfa;
+    // Only for the patterns of uncompiled fallback entries
+    if (std::ranges::any_of(dfa->fallback,
+                            [tbl](auto i) { return !(*tbl)[i].compiled; }))
+      m.index = get_index(tbl);
+  } else
+    m.index = get_index(tbl);
+
+  std::size_t threads{1};
+  lexer_cache *cache{};
+  if (info) {
+    threads = info->threads ? info->threads
+                            : std::thread::hardware_concurrency();
+    cache = info->cache;
+  }
+  // Checked before the bounds are made, which would allocate
+  const auto count = get_chunks(inp->size(), threads);
+  if (count == 1) {
+    tokenize_chunk(tbl, &m, cache, inp, 0, inp->size(), out);
+    return;
   }
 
-  return std::move(ctx.token_sequence);
+  const auto bounds = get_bounds(inp, count);
+  std::vector<std::vector<token_ref>> chunks(bounds.size() - 1);
+  parallel_for(chunks.size(), [&](std::size_t c) {
+    tokenize_chunk(tbl, &m, cache, inp, bounds[c], bounds[c + 1],
+                   &chunks[c]);
+  });
+
+  std::size_t size{};
+  for (const auto &c : chunks)
+    size += c.size();
+  out->reserve(size);
+  for (const auto &c : chunks)
+    out->insert(out->end(), c.begin(), c.end());
 }
 } // namespace cfg
 
@@ -115,84 +479,96 @@ cfg::lexer_mode detect_mode(const std::string &token) {
 } // namespace
 
 namespace {
-cfg::result find_table_entries(const cfg::lexer_table_t *table,
-                               const std::string &str,
-                               cfg::lexer_table_t *findings) {
-  cfg::result r{cfg::result::match_failure};
-
-  for (const auto &entry : *table) {
-    if (std::regex_match(str, entry.pattern)) {
-      if (findings)
-        findings->push_back(entry);
-      r = cfg::result::success;
-    }
-  }
-
-  return r;
+// The text -c for every byte c, which flags in lists like -hp refer to
+constexpr auto flag_texts = [] {
+  std::array<std::array<char, 2>, 256> out{};
+  for (std::size_t c = 0; c < out.size(); ++c)
+    out[c] = {'-', static_cast<char>(c)};
+  return out;
+}();
+
+std::string_view flag_text(char c) {
+  return {flag_texts[static_cast<unsigned char>(c)].data(), 2};
 }
 
-cfg::result first_token_id_match(const cfg::lexer_table_t *tbl,
-                                 const cfg::token_type type,
-                                 const std::string &str, std::string *id) {
-  cfg::lexer_table_t matches{};
-  if (auto r = find_table_entries(tbl, str, &matches);
-      r != cfg::result::success)
-    return r;
+std::uint32_t first_literal(const cfg::lexer_matcher *m, std::string_view str,
+                            cfg::token_type type) {
+  const auto t = static_cast<std::size_t>(type);
+  if (str.size() == 2 && str[0] == '-')
+    return m->index->flags[static_cast<unsigned char>(str[1])][t];
+  const auto it = m->index->literals.find(str);
+  return it == m->index->literals.end() ? cfg::no_token_entry
+                                        : it->second[t];
+}
 
-  for (const auto &m : matches) {
-    if (m.type == type) {
-      if (id)
-        *id = m.id;
-      return cfg::result::success;
+// The first entry of a type matching the string. The candidate the
+// automaton or the literal index gives is only overtaken by a pattern
+// matched with its std::regex that comes before it.
+std::uint32_t first_match(const cfg::lexer_table_t *tbl,
+                          const cfg::lexer_matcher *m, std::string_view str,
+                          cfg::token_type type) {
+  std::uint32_t first{cfg::no_token_entry};
+  if (m->dfa) {
+    for (const auto i : cfg::get_matches(m->dfa, str))
+      if ((*tbl)[i].type == type) {
+        first = i;
+        break;
+      }
+  } else
+    first = first_literal(m, str, type);
+
+  for (const auto i : m->dfa ? m->dfa->fallback : m->index->patterns) {
+    if (i >= first)
+      break;
+    const auto &e = (*tbl)[i];
+    if (e.type == type &&
+        std::regex_match(str.begin(), str.end(),
+                         e.compiled ? e.pattern : m->index->deferred[i])) {
+      first = i;
+      break;
     }
   }
-
-  return cfg::result::match_failure;
+  return first;
 }
 } // namespace
 
 namespace {
 cfg::result tokenize_single_id(const cfg::lexer_table_t *tbl,
-                               const std::string &str, cfg::token_t *tok) {
-  std::string id{};
-  auto r = first_token_id_match(tbl, cfg::token_type::option, str, &id);
-  if (r != cfg::result::success)
-    r = first_token_id_match(tbl, cfg::token_type::flag, str, &id);
-
-  if (tok) {
-    tok->id = std::move(id);
-    tok->value = str;
-  }
+                               const cfg::lexer_matcher *m,
+                               const std::string &str, cfg::token_ref *tok) {
+  auto e = first_match(tbl, m, str, cfg::token_type::option);
+  if (e == cfg::no_token_entry)
+    e = first_match(tbl, m, str, cfg::token_type::flag);
+
+  if (tok)
+    *tok = make_token(tbl, e, str);
 
-  return r;
+  return e != cfg::no_token_entry ? cfg::result::success
+                                  : cfg::result::match_failure;
 }
 } // namespace
 
 namespace {
 cfg::result tokenize_id_list(const cfg::lexer_table_t *tb,
+                             const cfg::lexer_matcher *m,
                              const std::string &fl,
-                             std::vector<cfg::token_t> *&tl) {
-  std::vector<cfg::token_t> toks{};
+                             std::vector<cfg::token_ref> *tl) {
+  // The tokens go to the output directly and are taken back on failure
+  const auto size = tl->size();
 
   for (std::size_t i = 1; i < fl.size(); ++i) {
-    const auto s = std::string{"-"} + fl[i];
-    std::string id{};
-    const auto opt = first_token_id_match(tb, cfg::token_type::option, s, &id);
-    cfg::token_t tok{};
-    if (auto r = tokenize_flag(tb, fl[i], &tok); r == cfg::result::success)
-      toks.push_back(std::move(tok));
-    else if (i == fl.size() - 1 && opt == cfg::result::success) {
-      tok.id = std::move(id);
-      tok.value = fl[i];
-      toks.push_back(std::move(tok));
-    } else
+    const auto opt =
+        first_match(tb, m, flag_text(fl[i]), cfg::token_type::option);
+    cfg::token_ref tok{};
+    if (auto r = tokenize_flag(tb, m, fl[i], &tok);
+        r == cfg::result::success)
+      tl->push_back(tok);
+    else if (i == fl.size() - 1 && opt != cfg::no_token_entry)
+      tl->push_back(make_token(tb, opt, std::string_view{fl}.substr(i, 1)));
+    else {
+      tl->resize(size);
       return cfg::result::match_failure;
-  }
-
-  if (tl) {
-    tl->reserve(tl->size() + toks.size());
-    for (auto &&e : toks)
-      tl->push_back(std::move(e));
+    }
   }
 
   return cfg::result::success;
@@ -200,22 +576,22 @@ cfg::result tokenize_id_list(const cfg::lexer_table_t *tb,
 } // namespace
 
 namespace {
-cfg::result tokenize_flag(const cfg::lexer_table_t *tbl, const std::string &str,
-                          cfg::token_t *tok) {
-  std::string id{};
-  auto r = first_token_id_match(tbl, cfg::token_type::flag, str, &id);
-
-  if (tok) {
-    tok->id = std::move(id);
-    tok->value = str;
-  }
+cfg::result tokenize_flag(const cfg::lexer_table_t *tbl,
+                          const cfg::lexer_matcher *m, std::string_view str,
+                          cfg::token_ref *tok) {
+  const auto e = first_match(tbl, m, str, cfg::token_type::flag);
+
+  if (tok)
+    *tok = make_token(tbl, e, str);
 
-  return r;
+  return e != cfg::no_token_entry ? cfg::result::success
+                                  : cfg::result::match_failure;
 }
 
-cfg::result tokenize_flag(const cfg::lexer_table_t *l, const char c,
-                          cfg::token_t *t) {
-  return tokenize_flag(l, std::string{"-"} + c, t);
+cfg::result tokenize_flag(const cfg::lexer_table_t *l,
+                          const cfg::lexer_matcher *m, const char c,
+                          cfg::token_ref *t) {
+  return tokenize_flag(l, m, flag_text(c), t);
 }
 } // namespace
 
@@ -235,6 +611,33 @@ std::ostream &operator<<(std::ostream &o, const cfg::token_type &t) {
 }
 
 namespace cfg {
+result get_literals(const std::string &pattern, std::vector<std::string> *out) {
+  constexpr std::string_view special{"^$\\.*+?()[]{}|"};
+  std::vector<std::string> literals{{}};
+  for (std::size_t i = 0; i < pattern.size(); ++i) {
+    const auto c = pattern[i];
+    auto &current = literals.back();
+    if (c == '|')
+      literals.emplace_back();
+    else if (c == '\\' && i + 1 < pattern.size() &&
+             special.find(pattern[i + 1]) != std::string_view::npos)
+      current += pattern[++i];
+    else if (c == '^' && current.empty() &&
+             (!i || pattern[i - 1] == '|'))
+      continue;
+    else if (c == '$' && (i + 1 == pattern.size() || pattern[i + 1] == '|'))
+      continue;
+    else if (special.find(c) != std::string_view::npos)
+      return result::match_failure;
+    else
+      current += c;
+  }
+
+  if (out)
+    *out = std::move(literals);
+  return result::success;
+}
+
 result read_from_file(const std::string &path, lexer_table_t *tbl) {
   std::ifstream str{path};
   if (!str.is_open())
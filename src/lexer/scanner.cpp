@@ -0,0 +1,147 @@
+#include <cfgtk/lexer.hpp>
+#include <detail/mapped_file.hpp>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+
+namespace {
+constexpr std::uint32_t no_entry{std::numeric_limits<std::uint32_t>::max()};
+const cfg::scanner_info default_info{};
+
+struct munch {
+  std::size_t length{};
+  std::uint32_t entry{no_entry};
+};
+
+// The longest non-empty prefix an entry accepts, and the first entry
+// accepting it
+munch find_longest(const cfg::lexer_automaton *a, std::string_view s) {
+  munch best{};
+  auto state = a->start;
+  for (std::size_t i = 0; i < s.size(); ++i) {
+    state = a->transitions[state * a->class_count +
+                           a->classes[static_cast<unsigned char>(s[i])]];
+    if (state == a->reject)
+      break;
+    if (a->accept_offsets[state] != a->accept_offsets[state + 1])
+      best = {i + 1, a->accepts[a->accept_offsets[state]]};
+  }
+  return best;
+}
+
+bool is_usable(const cfg::lexer_table_t *tbl, const cfg::lexer_automaton *a) {
+  return cfg::is_compiled_from(a, tbl) && a->fallback.empty();
+}
+
+// Emits the token at the front of the input and returns the bytes it
+// consumed; bytes no entry starts with become tokens without an id.
+std::size_t step(const cfg::lexer_table_t *tbl, const cfg::lexer_automaton *a,
+                 std::string_view s, const cfg::scanner_info *info,
+                 const cfg::token_ref_sink_t &sink) {
+  if (info->skip_space && std::isspace(static_cast<unsigned char>(s[0])))
+    return 1;
+
+  const auto m = find_longest(a, s.substr(0, info->max_token));
+  if (m.entry == no_entry) {
+    sink({.value = s.substr(0, 1)});
+    return 1;
+  }
+  sink({.entry = m.entry,
+        .id = (*tbl)[m.entry].id,
+        .value = s.substr(0, m.length)});
+  return m.length;
+}
+
+// Copies the references into owning tokens
+cfg::token_ref_sink_t to_owning(const cfg::token_sink_t &sink) {
+  if (!sink)
+    return {};
+  return [&sink](const cfg::token_ref &t) {
+    sink({cfg::symbol_t{t.id}, std::string{t.value}});
+  };
+}
+} // namespace
+
+namespace cfg {
+result scan(const lexer_table_t *tbl, const lexer_automaton *a,
+            std::string_view in, const token_ref_sink_t &sink,
+            const scanner_info *info) {
+  if (!info)
+    info = &default_info;
+  if (!is_usable(tbl, a) || !sink || !info->max_token)
+    return result::format_error;
+
+  for (std::size_t pos = 0; pos < in.size();)
+    pos += step(tbl, a, in.substr(pos), info, sink);
+  return result::success;
+}
+
+result scan(const lexer_table_t *tbl, const lexer_automaton *a,
+            std::istream *in, const token_ref_sink_t &sink,
+            const scanner_info *info) {
+  if (!info)
+    info = &default_info;
+  if (!is_usable(tbl, a) || !in || !sink || !info->max_token)
+    return result::format_error;
+
+  // Holds at least max_token bytes ahead of the next token until the end
+  // of the stream, so every token fits without growing it
+  std::vector<char> buffer(2 * info->max_token);
+  std::size_t begin{}, end{};
+  bool eof{};
+  for (;;) {
+    if (!eof && end - begin < info->max_token) {
+      std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+      end -= begin;
+      begin = 0;
+      in->read(buffer.data() + end,
+               static_cast<std::streamsize>(buffer.size() - end));
+      end += static_cast<std::size_t>(in->gcount());
+      eof = !*in;
+    }
+    if (begin == end)
+      break;
+    begin += step(tbl, a, {buffer.data() + begin, end - begin}, info, sink);
+  }
+  return in->bad() ? result::file_access_failure : result::success;
+}
+
+result scan_file(const lexer_table_t *tbl, const lexer_automaton *a,
+                 const std::string &path, const token_ref_sink_t &sink,
+                 const scanner_info *info) {
+  mapped_file m{};
+  switch (map_file(path, &m)) {
+  case map_status::mapped:
+    return scan(tbl, a, m.view(), sink, info);
+  case map_status::unmappable: {
+    // Pipes and the like are scanned as a stream, with bounded memory
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+      return result::file_access_failure;
+    return scan(tbl, a, &in, sink, info);
+  }
+  default:
+    return result::file_access_failure;
+  }
+}
+
+result scan(const lexer_table_t *tbl, const lexer_automaton *a,
+            std::string_view in, const token_sink_t &sink,
+            const scanner_info *info) {
+  return scan(tbl, a, in, to_owning(sink), info);
+}
+
+result scan(const lexer_table_t *tbl, const lexer_automaton *a,
+            std::istream *in, const token_sink_t &sink,
+            const scanner_info *info) {
+  return scan(tbl, a, in, to_owning(sink), info);
+}
+
+result scan_file(const lexer_table_t *tbl, const lexer_automaton *a,
+                 const std::string &path, const token_sink_t &sink,
+                 const scanner_info *info) {
+  return scan_file(tbl, a, path, to_owning(sink), info);
+}
+} // namespace cfg
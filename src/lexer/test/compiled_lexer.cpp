@@ -0,0 +1,111 @@
+#include <cfgtk/lexer.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+using namespace cfg;
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 3) {
+    std::cerr << "Too few paramaters; Usage: "
+                 "<token-desc-file> <binary-file> <input>\n";
+    return 1;
+  }
+
+  lexer_table_t tbl{};
+  lexer_automaton dfa{};
+  if (read_from_file(argv[1], &tbl) != result::success ||
+      compile(&tbl, &dfa) != result::success) {
+    std::cerr << "Reading the token table '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  const std::string path{argv[2]};
+  if (write_to_file(path, &tbl, &dfa) != result::success) {
+    std::cerr << "Writing the table to '" << path << "' failed.\n";
+    return 3;
+  }
+
+  lexer_table_t loaded{};
+  lexer_automaton loaded_dfa{};
+  if (read_from_file(path, &loaded, &loaded_dfa) != result::success) {
+    std::cerr << "Loading the table from '" << path << "' failed.\n";
+    return 4;
+  }
+
+  if (to_string(&loaded) != to_string(&tbl)) {
+    std::cerr << "The loaded entries differ:\n" << to_string(&loaded) << '\n';
+    return 5;
+  }
+
+  auto input = std::vector<std::string>{};
+  if (argc > 3)
+    input = flt::to_container<std::vector>(argc, argv, 3);
+
+  // Without its automaton, the loaded table has to compile the patterns
+  // it needs rather than match nothing with them
+  const auto expected = tokenize(&tbl, &input);
+  lexer_automaton none{};
+  for (const auto &tokens : {tokenize(&loaded, &loaded_dfa, &input),
+                             tokenize(&loaded, &none, &input),
+                             tokenize(&loaded, &input)}) {
+    if (tokens.size() != expected.size()) {
+      std::cerr << "Expected " << expected.size() << " tokens, have "
+                << tokens.size() << ".\n";
+      return 6;
+    }
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+      if (tokens[i].id != expected[i].id ||
+          tokens[i].value != expected[i].value) {
+        std::cerr << "Expected: " << expected[i].id << ":"
+                  << expected[i].value << std::endl;
+        std::cerr << "But have: " << tokens[i].id << ":" << tokens[i].value
+                  << std::endl;
+        return 7;
+      }
+  }
+
+  // A cut off file must be rejected rather than read past its end
+  const auto size = fs::file_size(path);
+  fs::resize_file(path, size - 1);
+  if (read_from_file(path, &loaded, &loaded_dfa) != result::format_error) {
+    std::cerr << "A truncated file was loaded.\n";
+    return 8;
+  }
+
+  // So must a table whose automaton falls back to patterns
+  lexer_table_t fallback{};
+  lexer_automaton fallback_dfa{};
+  add_entry(&fallback, token_type::free, "twice-tok", "(ab)\\1");
+  if (compile(&fallback, &fallback_dfa) != result::success ||
+      write_to_file(path, &fallback, &fallback_dfa) != result::format_error) {
+    std::cerr << "A table with fallback entries was written.\n";
+    return 9;
+  }
+
+  // And an automaton whose state lists its accepts out of order, which
+  // would give the later of two overlapping entries as the first match
+  lexer_table_t overlap{};
+  lexer_automaton swapped{};
+  add_entry(&overlap, token_type::free, "digit-tok", "[0-9]");
+  add_entry(&overlap, token_type::free, "any-tok", ".");
+  if (compile(&overlap, &swapped) != result::success) {
+    std::cerr << "Compiling the overlapping table failed.\n";
+    return 10;
+  }
+  const auto accepts = swapped.accepts;
+  for (std::size_t s = 0; s + 1 < swapped.accept_offsets.size(); ++s)
+    if (swapped.accept_offsets[s + 1] - swapped.accept_offsets[s] > 1) {
+      std::swap(swapped.accepts[swapped.accept_offsets[s]],
+                swapped.accepts[swapped.accept_offsets[s] + 1]);
+      break;
+    }
+  if (swapped.accepts == accepts ||
+      write_to_file(path, &overlap, &swapped) != result::success ||
+      read_from_file(path, &loaded, &loaded_dfa) != result::format_error) {
+    std::cerr << "An automaton with its accepts out of order was loaded.\n";
+    return 11;
+  }
+}
@@ -36,18 +36,51 @@ int main(int argc, char **argv) {
     cont = flt::to_container<std::vector>(argc, argv, 3);
 
   const std::string expected{argv[2]};
-  std::stringstream summary{};
 
-  auto tokens = tokenize(&tbl, &cont);
+  lexer_automaton dfa{};
+  if (compile(&tbl, &dfa) != result::success) {
+    std::cerr << "Compiling the token table failed.\n";
+    return 6;
+  }
+
+  // Both the patterns and the automaton must give the expected tokens,
+  // as copies and as references into a reused vector
+  std::vector<token_ref> refs{};
+  for (const auto *a : {static_cast<const lexer_automaton *>(nullptr),
+                        static_cast<const lexer_automaton *>(&dfa)}) {
+    auto tokens = tokenize(&tbl, a, &cont);
 
-  for (std::size_t i = 0; i < tokens.size(); ++i)
-    summary << tokens[i].id + ":" << tokens[i].value
-            << (i == tokens.size() - 1 ? "" : " ");
+    std::stringstream summary{};
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+      summary << tokens[i].id + ":" << tokens[i].value
+              << (i == tokens.size() - 1 ? "" : " ");
+
+    if (expected != summary.str()) {
+      std::cerr << "Expected: " << expected << std::endl;
+      std::cout << "But have: " << summary.str()
+                << (a ? " (automaton)" : " (patterns)") << std::endl;
+      std::cout << "The token table is:\n" << to_string(&tbl) << std::endl;
+      return 5;
+    }
 
-  if (expected != summary.str()) {
-    std::cerr << "Expected: " << expected << std::endl;
-    std::cout << "But have: " << summary.str() << std::endl;
-    std::cout << "The token table is:\n" << to_string(&tbl) << std::endl;
-    return 5;
+    tokenize(&tbl, a, &cont, &refs);
+    std::stringstream refs_summary{};
+    for (std::size_t i = 0; i < refs.size(); ++i) {
+      if (refs[i].id != (refs[i].entry < tbl.size() ? tbl[refs[i].entry].id
+                                                    : std::string{})) {
+        std::cerr << "The token '" << refs[i].value
+                  << "' refers to the wrong entry.\n";
+        return 7;
+      }
+      refs_summary << refs[i].id << ":" << refs[i].value
+                   << (i == refs.size() - 1 ? "" : " ");
+    }
+
+    if (expected != refs_summary.str()) {
+      std::cerr << "Expected: " << expected << std::endl;
+      std::cout << "But have: " << refs_summary.str() << " (references)"
+                << std::endl;
+      return 8;
+    }
   }
 }
@@ -0,0 +1,88 @@
+#include <cfgtk/lexer.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace cfg;
+
+namespace {
+std::atomic<std::size_t> allocations{};
+} // namespace
+
+// Every allocation of the program goes through these, so they are counted
+void *operator new(std::size_t n) {
+  ++allocations;
+  if (auto *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 3) {
+    std::cerr << "Too few paramaters; Usage: "
+                 "<token-desc-file> <input>\n";
+    return 1;
+  }
+
+  lexer_table_t tbl{};
+  lexer_automaton dfa{};
+  if (read_from_file(argv[1], &tbl) != result::success ||
+      compile(&tbl, &dfa) != result::success || dfa.fallback.size()) {
+    std::cerr << "The token table '" << argv[1]
+              << "' could not be compiled without fallback entries.\n";
+    return 2;
+  }
+
+  const lexer_input_t input(argv + 2, argv + argc);
+  std::vector<token_ref> tokens{};
+  tokenize(&tbl, &dfa, &input, &tokens);
+  if (tokens.empty())
+    return 3;
+
+  // Once the vector has the capacity, tokenizing again allocates nothing
+  const auto before = allocations.load();
+  const tokenize_info info{};
+  for (int i = 0; i < 100; ++i) {
+    tokenize(&tbl, &dfa, &input, &tokens);
+    tokenize(&tbl, &dfa, &input, &tokens, &info);
+  }
+  const auto count = allocations - before;
+  if (count) {
+    std::cerr << "Tokenizing with a reused vector allocated " << count
+              << " times.\n";
+    return 4;
+  }
+
+  // Nor does scanning a buffer or a mapped file into references
+  std::string text{};
+  for (const auto &s : input)
+    text += s + ' ';
+  const auto path = fs::path{"test_lexer_allocation_input." +
+                             std::to_string(::getpid()) + ".txt"};
+  std::ofstream{path} << text;
+  const auto file = path.string();
+
+  std::size_t scanned{};
+  const token_ref_sink_t sink = [&scanned](const token_ref &) { ++scanned; };
+  const auto scan_before = allocations.load();
+  const auto r = scan(&tbl, &dfa, text, sink);
+  const auto rf = scan_file(&tbl, &dfa, file, sink);
+  const auto scan_count = allocations - scan_before;
+  std::error_code ec{};
+  fs::remove(path, ec);
+  if (r != result::success || rf != result::success || !scanned ||
+      scan_count) {
+    std::cerr << "Scanning into references allocated " << scan_count
+              << " times.\n";
+    return 5;
+  }
+}
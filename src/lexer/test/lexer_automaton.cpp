@@ -0,0 +1,121 @@
+#include <cfgtk/lexer.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <set>
+
+namespace fs = std::filesystem;
+using namespace cfg;
+
+namespace {
+// The inputs to compare on: the alternatives of every pattern, and every
+// string up to the given length over the bytes the patterns use
+std::set<std::string> make_inputs(const lexer_table_t *tbl,
+                                  std::size_t length) {
+  std::set<char> bytes{'\n', '\r', ' ', '~'};
+  std::set<std::string> out{""};
+  for (const auto &e : *tbl) {
+    bytes.insert(e.regex.begin(), e.regex.end());
+    for (const auto &s : flt::split<std::vector>(e.regex, "|", true))
+      out.insert(s);
+  }
+  bytes.erase('\\');
+
+  std::vector<std::string> level{""};
+  for (std::size_t i = 0; i < length; ++i) {
+    std::vector<std::string> next{};
+    for (const auto &s : level)
+      for (const auto c : bytes)
+        next.push_back(s + c);
+    out.insert(next.begin(), next.end());
+    level = std::move(next);
+  }
+  return out;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 4) {
+    std::cerr << "Too few paramaters; Usage: "
+                 "<token-desc-file> <input-length> <fallback-entries>\n";
+    return 1;
+  }
+
+  lexer_table_t tbl{};
+  if (read_from_file(argv[1], &tbl) != result::success) {
+    std::cerr << "Reading the token table '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  lexer_automaton dfa{};
+  if (compile(&tbl, &dfa) != result::success) {
+    std::cerr << "Compiling the token table failed.\n";
+    return 3;
+  }
+
+  if (dfa.fallback.size() != std::stoul(argv[3])) {
+    std::cerr << "Expected " << argv[3] << " entries to fall back to "
+              << "their patterns, have " << dfa.fallback.size() << ".\n";
+    return 4;
+  }
+
+  for (const auto &s : make_inputs(&tbl, std::stoul(argv[2]))) {
+    const auto matches = get_matches(&dfa, s);
+    for (std::uint32_t i = 0; i < tbl.size(); ++i) {
+      if (std::find(dfa.fallback.begin(), dfa.fallback.end(), i) !=
+          dfa.fallback.end())
+        continue;
+      const bool has = std::find(matches.begin(), matches.end(), i) !=
+                       matches.end();
+      if (has != std::regex_match(s, tbl[i].pattern)) {
+        std::cerr << "The automaton and '" << tbl[i].regex
+                  << "' disagree on '" << s << "'.\n";
+        return 5;
+      }
+    }
+  }
+
+  // Automata that do not belong to the table are not used: one that was
+  // never compiled, and one compiled from a table of the same size
+  lexer_automaton empty{};
+  lexer_automaton stale{};
+  const lexer_table_t reversed(tbl.rbegin(), tbl.rend());
+  compile(&reversed, &stale);
+  if (get_matches(&empty, "").size() || is_compiled_from(&empty, &tbl) ||
+      is_compiled_from(&stale, &tbl) || !is_compiled_from(&dfa, &tbl)) {
+    std::cerr << "An automaton was taken for one of the table.\n";
+    return 6;
+  }
+
+  const auto strings = make_inputs(&tbl, 1);
+  const lexer_input_t input(strings.begin(), strings.end());
+  const auto expected = tokenize(&tbl, &input);
+  for (const auto *a : {&empty, &stale}) {
+    const auto tokens = tokenize(&tbl, a, &input);
+    if (tokens.size() != expected.size())
+      return 7;
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+      if (tokens[i].id != expected[i].id ||
+          tokens[i].value != expected[i].value) {
+        std::cerr << "'" << tokens[i].value << "' was classified as '"
+                  << tokens[i].id << "' instead of '" << expected[i].id
+                  << "'.\n";
+        return 7;
+      }
+  }
+
+  // Without an automaton, a table changed in place is classified by its
+  // new entries, as the automaton compiled from them does
+  auto changed = tbl;
+  tokenize(&changed, &input);
+  changed.assign(reversed.begin(), reversed.end());
+  const auto literal = tokenize(&changed, &input);
+  const auto automatic = tokenize(&changed, &stale, &input);
+  for (std::size_t i = 0; i < literal.size(); ++i)
+    if (literal[i].id != automatic[i].id) {
+      std::cerr << "'" << literal[i].value << "' was classified as '"
+                << literal[i].id << "' by a changed table.\n";
+      return 8;
+    }
+}
@@ -0,0 +1,108 @@
+#include <cfgtk/lexer.hpp>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+namespace fs = std::filesystem;
+using namespace cfg;
+
+namespace {
+// The same argument classified in different modes, as after a --, must
+// not share its tokens
+const std::vector<std::string> words{"--",   "-l", "-bme",  "-bl",
+                                     "-lb",  "-x", "--pin", "12",
+                                     "012",  "-",  "- x",   "--length"};
+
+bool is_same(const std::vector<token_ref> &a,
+             const std::vector<token_ref> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    if (a[i].entry != b[i].entry || a[i].id != b[i].id ||
+        a[i].value != b[i].value)
+      return false;
+  return true;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 4) {
+    std::cerr << "Too few paramaters; Usage: "
+                 "<token-desc-file> <input-size> <cache-capacity>\n";
+    return 1;
+  }
+
+  lexer_table_t tbl{};
+  lexer_automaton dfa{};
+  if (read_from_file(argv[1], &tbl) != result::success ||
+      compile(&tbl, &dfa) != result::success) {
+    std::cerr << "Reading the token table '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  std::mt19937 gen{};
+  std::uniform_int_distribution<std::size_t> pick{0, words.size() - 1};
+  lexer_input_t input(std::stoul(argv[2]));
+  for (auto &s : input)
+    s = words[pick(gen)];
+
+  lexer_cache cache{std::stoul(argv[3])};
+  for (const auto *a : {static_cast<const lexer_automaton *>(nullptr),
+                        static_cast<const lexer_automaton *>(&dfa)}) {
+    std::vector<token_ref> expected{};
+    tokenize(&tbl, a, &input, &expected);
+
+    // Cold, warm and shared by threads
+    for (const std::size_t threads : {1, 1, 4}) {
+      const tokenize_info info{.threads = threads, .cache = &cache};
+      std::vector<token_ref> cached{};
+      tokenize(&tbl, a, &input, &cached, &info);
+      if (!is_same(expected, cached)) {
+        std::cerr << "Tokenizing through the cache on " << threads
+                  << " threads" << (a ? " with the automaton" : "")
+                  << " gives other tokens.\n";
+        return 3;
+      }
+    }
+  }
+
+  // Each word is at most classified in two modes
+  const auto calls = 6 * input.size();
+  if (cache.stats.hits + cache.stats.misses > calls ||
+      cache.stats.hits + cache.stats.misses < calls / 2) {
+    std::cerr << "The cache was asked " << cache.stats.hits + cache.stats.misses
+              << " times for " << calls << " arguments.\n";
+    return 4;
+  }
+
+  std::cout << "hit rate: " << get_hit_rate(&cache.stats) << std::endl;
+  if (std::stoul(argv[3]) >= 2 * words.size() * 16 &&
+      get_hit_rate(&cache.stats) < 0.95) {
+    std::cerr << "The cache holds every argument but missed too often.\n";
+    return 5;
+  }
+
+  clear(&cache);
+  const auto misses = cache.stats.misses.load();
+  std::vector<token_ref> out{};
+  const tokenize_info info{.cache = &cache};
+  tokenize(&tbl, &dfa, &input, &out, &info);
+  if (input.size() && cache.stats.misses == misses) {
+    std::cerr << "Clearing the cache left arguments in it.\n";
+    return 6;
+  }
+
+  // An entry put in front of the others takes their arguments, cached or not
+  tbl.insert(tbl.begin(), {token_type::option, "first-tok", "--length|-l"});
+  for (const auto *a : {static_cast<const lexer_automaton *>(nullptr),
+                        static_cast<const lexer_automaton *>(&dfa)}) {
+    std::vector<token_ref> expected{}, cached{};
+    tokenize(&tbl, a, &input, &expected);
+    tokenize(&tbl, a, &input, &cached, &info);
+    if (!is_same(expected, cached)) {
+      std::cerr << "A table changed in place got tokens cached before.\n";
+      return 7;
+    }
+  }
+}
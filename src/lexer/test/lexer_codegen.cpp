@@ -0,0 +1,54 @@
+#include <cfgtk/lexer.hpp>
+#include <lexer_table_001.hpp>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+using namespace cfg;
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 2) {
+    std::cerr << "Too few paramaters; Usage: <token-desc-file> <input>\n";
+    return 1;
+  }
+
+  lexer_table_t tbl{};
+  if (read_from_file(argv[1], &tbl) != result::success) {
+    std::cerr << "Reading the token table '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  auto input = std::vector<std::string>{};
+  if (argc > 2)
+    input = flt::to_container<std::vector>(argc, argv, 2);
+
+  const auto expected = tokenize(&tbl, &input);
+  const auto tokens = lex_001::tokenize(input);
+  if (tokens.size() != expected.size()) {
+    std::cerr << "Expected " << expected.size() << " tokens, have "
+              << tokens.size() << ".\n";
+    return 3;
+  }
+
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    const auto id = lex_001::names[static_cast<std::size_t>(tokens[i].id)];
+    if (id != expected[i].id || tokens[i].value != expected[i].value) {
+      std::cerr << "Expected: " << expected[i].id << ":" << expected[i].value
+                << std::endl;
+      std::cerr << "But have: " << id << ":" << tokens[i].value << std::endl;
+      return 4;
+    }
+  }
+
+  // Ids are written into string literals, escaped down to printable bytes
+  lexer_table_t odd{};
+  add_entry(&odd, token_type::free, "line\nbreak\\", "x");
+  const lexer_encoding enc{};
+  const auto code = to_string(&odd, &enc);
+  if (code.find("\"line\\012break\\\\\"") == std::string::npos ||
+      code.find("line\n") != std::string::npos) {
+    std::cerr << "An id was not escaped:\n" << code << std::endl;
+    return 5;
+  }
+}
@@ -0,0 +1,31 @@
+#include <cfgtk/lexer.hpp>
+#include <iostream>
+
+// Writes the specialized lexer generated from a token table file; used by
+// the build to produce the code under test.
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<token-desc-file> <output-file> <namespace>\n";
+    return 1;
+  }
+
+  cfg::lexer_table_t tbl{};
+  if (cfg::read_from_file(argv[1], &tbl) != cfg::result::success) {
+    std::cerr << "Reading the token table '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  cfg::lexer_encoding e{};
+  e.namespace_name = argv[3];
+  const auto code = cfg::to_string(&tbl, &e);
+  if (code.empty()) {
+    std::cerr << "The token table cannot be turned into code.\n";
+    return 3;
+  }
+
+  if (cfg::write_to_file(argv[2], code + "\n") != cfg::result::success) {
+    std::cerr << "Writing to: '" << argv[2] << "' failed.\n";
+    return 4;
+  }
+}
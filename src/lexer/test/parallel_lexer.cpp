@@ -0,0 +1,69 @@
+#include <cfgtk/lexer.hpp>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+namespace fs = std::filesystem;
+using namespace cfg;
+
+namespace {
+// Arguments of every mode, with -- often enough that runs of it keep
+// landing on chunk bounds
+const std::vector<std::string> words{"--", "--", "--",     "-l",  "-bme",
+                                     "-bl", "-lb", "--pin", "12",  "012",
+                                     "-x",  "- x", "-",     "--no"};
+
+bool is_same(const std::vector<token_ref> &a,
+             const std::vector<token_ref> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    if (a[i].entry != b[i].entry || a[i].id != b[i].id ||
+        a[i].value.data() != b[i].value.data() ||
+        a[i].value.size() != b[i].value.size())
+      return false;
+  return true;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 3) {
+    std::cerr << "Too few paramaters; Usage: "
+                 "<token-desc-file> <input-size> [only-forced]\n";
+    return 1;
+  }
+
+  lexer_table_t tbl{};
+  lexer_automaton dfa{};
+  if (read_from_file(argv[1], &tbl) != result::success ||
+      compile(&tbl, &dfa) != result::success) {
+    std::cerr << "Reading the token table '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  const bool forced_only = argc > 3;
+  std::mt19937 gen{};
+  std::uniform_int_distribution<std::size_t> pick{0, words.size() - 1};
+  lexer_input_t input(std::stoul(argv[2]));
+  for (auto &s : input)
+    s = forced_only ? "--" : words[pick(gen)];
+
+  for (const auto *a : {static_cast<const lexer_automaton *>(nullptr),
+                        static_cast<const lexer_automaton *>(&dfa)}) {
+    std::vector<token_ref> serial{};
+    tokenize(&tbl, a, &input, &serial);
+
+    for (const std::size_t threads : {2, 3, 7, 16, 0}) {
+      const tokenize_info info{.threads = threads};
+      std::vector<token_ref> parallel{};
+      tokenize(&tbl, a, &input, &parallel, &info);
+      if (!is_same(serial, parallel)) {
+        std::cerr << "Tokenizing on " << threads << " threads"
+                  << (a ? " with the automaton" : "")
+                  << " differs from tokenizing on one.\n";
+        return 3;
+      }
+    }
+  }
+}
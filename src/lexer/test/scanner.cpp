@@ -0,0 +1,90 @@
+#include <cfgtk/lexer.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace cfg;
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 4) {
+    std::cerr << "Too few paramaters; Usage: "
+                 "<token-desc-file> <expected output> <input>\n";
+    return 1;
+  }
+
+  lexer_table_t tbl{};
+  lexer_automaton dfa{};
+  if (read_from_file(argv[1], &tbl) != result::success ||
+      compile(&tbl, &dfa) != result::success) {
+    std::cerr << "Reading the token table '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  const std::string expected{argv[2]}, input{argv[3]};
+  std::stringstream summary{};
+  const token_sink_t sink = [&summary](token_t &&t) {
+    summary << (summary.tellp() ? " " : "") << t.id << ":" << t.value;
+  };
+  const token_ref_sink_t ref_sink = [&summary](const token_ref &t) {
+    summary << (summary.tellp() ? " " : "") << t.id << ":" << t.value;
+  };
+
+  const auto check = [&](const char *source, result r) {
+    if (r != result::success || summary.str() != expected) {
+      std::cerr << "Expected: " << expected << std::endl;
+      std::cerr << "But have: " << summary.str() << " (" << source << ")"
+                << std::endl;
+      return false;
+    }
+    summary.str({});
+    summary.clear();
+    return true;
+  };
+
+  // A buffer, a stream refilled every few bytes, and a mapped file must
+  // all give the same tokens
+  if (!check("buffer", scan(&tbl, &dfa, input, sink)))
+    return 3;
+
+  std::stringstream stream{input};
+  scanner_info small{.max_token = 8};
+  if (!check("stream", scan(&tbl, &dfa, &stream, sink, &small)))
+    return 4;
+
+  // Tests may run at once, so the scratch files are named by process
+  const auto scratch = "test_scanner_input." + std::to_string(::getpid());
+  const auto path = fs::path{scratch + ".txt"};
+  std::error_code ec{};
+  std::ofstream{path} << input;
+  if (!check("file", scan_file(&tbl, &dfa, path.string(), sink)))
+    return 5;
+
+  // So must the references handed to a sink of them
+  std::stringstream ref_stream{input};
+  if (!check("buffer refs", scan(&tbl, &dfa, input, ref_sink)) ||
+      !check("stream refs", scan(&tbl, &dfa, &ref_stream, ref_sink, &small)) ||
+      !check("file refs", scan_file(&tbl, &dfa, path.string(), ref_sink)))
+    return 8;
+  fs::remove(path, ec);
+
+  // A FIFO cannot be mapped, so it is scanned as a stream
+  const auto fifo = fs::path{scratch + ".fifo"};
+  fs::remove(fifo, ec);
+  if (::mkfifo(fifo.c_str(), 0600) != 0) {
+    std::cerr << "Creating the FIFO at: '" << fifo << "' failed.\n";
+    return 6;
+  }
+
+  std::jthread writer{[&fifo, &input] { std::ofstream{fifo} << input; }};
+  const auto r = scan_file(&tbl, &dfa, fifo.string(), sink);
+  writer.join();
+  fs::remove(fifo, ec);
+  if (!check("fifo", r))
+    return 7;
+}
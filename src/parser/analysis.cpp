@@ -0,0 +1,271 @@
+#include <cfgtk/analysis.hpp>
+#include <algorithm>
+
+namespace {
+// Rules over symbol ids; the right hand sides are stored back to back
+struct rule_table {
+  std::vector<cfg::symbol_id_t> lhs{};
+  std::vector<std::size_t> offsets{};
+  std::vector<cfg::symbol_id_t> rhs{};
+
+  std::size_t size() const { return lhs.size(); }
+
+  std::span<const cfg::symbol_id_t> get_rhs(std::size_t r) const {
+    return {rhs.data() + offsets[r], rhs.data() + offsets[r + 1]};
+  }
+};
+
+rule_table make_table(const std::vector<const cfg::rule *> &rules,
+                      cfg::grammar_analysis *a) {
+  const auto intern = [a](const cfg::symbol_t &s) {
+    const auto [it, added] =
+        a->ids.try_emplace(s, static_cast<cfg::symbol_id_t>(a->symbols.size()));
+    if (added)
+      a->symbols.push_back(s);
+    return it->second;
+  };
+
+  for (const auto *r : rules)
+    intern(r->lhs);
+  a->nonterminals = a->symbols.size();
+
+  rule_table t{};
+  t.lhs.reserve(rules.size());
+  t.offsets.reserve(rules.size() + 1);
+  for (const auto *r : rules) {
+    t.lhs.push_back(a->ids.at(r->lhs));
+    t.offsets.push_back(t.rhs.size());
+    for (const auto &s : r->rhs)
+      t.rhs.push_back(intern(s));
+  }
+  t.offsets.push_back(t.rhs.size());
+  return t;
+}
+
+// Marks the left hand side of every rule whose right hand side consists of
+// marked symbols only; each occurrence is visited once.
+void close_over_rules(const rule_table &t, const cfg::grammar_analysis *a,
+                      cfg::symbol_set *marked) {
+  std::vector<std::vector<std::size_t>> uses(a->nonterminals);
+  std::vector<std::size_t> pending(t.size());
+  std::vector<cfg::symbol_id_t> work{};
+
+  const auto mark = [marked, &work](cfg::symbol_id_t s) {
+    if (!marked->test(s)) {
+      marked->set(s);
+      work.push_back(s);
+    }
+  };
+
+  for (std::size_t r = 0; r < t.size(); ++r) {
+    for (const auto s : t.get_rhs(r))
+      if (!marked->test(s)) {
+        // Unmarked terminals never become marked
+        if (s < uses.size())
+          uses[s].push_back(r);
+        ++pending[r];
+      }
+    if (!pending[r])
+      mark(t.lhs[r]);
+  }
+
+  while (work.size()) {
+    const auto s = work.back();
+    work.pop_back();
+    for (const auto r : uses[s])
+      if (!--pending[r])
+        mark(t.lhs[r]);
+  }
+}
+
+void find_reachable(const rule_table &t, cfg::grammar_analysis *a) {
+  std::vector<std::vector<std::size_t>> by_lhs(a->nonterminals);
+  for (std::size_t r = 0; r < t.size(); ++r)
+    by_lhs[t.lhs[r]].push_back(r);
+
+  std::vector<cfg::symbol_id_t> work{a->start};
+  a->reachable.set(a->start);
+  while (work.size()) {
+    const auto s = work.back();
+    work.pop_back();
+    if (a->is_terminal(s))
+      continue;
+    for (const auto r : by_lhs[s])
+      for (const auto x : t.get_rhs(r))
+        if (!a->reachable.test(x)) {
+          a->reachable.set(x);
+          work.push_back(x);
+        }
+  }
+}
+
+// Propagates sets along the edges until nothing changes; a non-terminal is
+// queued again only when one of its sources grew.
+void propagate(const std::vector<std::vector<cfg::symbol_id_t>> &edges,
+               std::vector<cfg::symbol_set> *sets) {
+  std::vector<cfg::symbol_id_t> work{};
+  std::vector<bool> queued(edges.size(), true);
+  for (std::size_t s = edges.size(); s > 0; --s)
+    work.push_back(static_cast<cfg::symbol_id_t>(s - 1));
+
+  while (work.size()) {
+    const auto s = work.back();
+    work.pop_back();
+    queued[s] = false;
+    for (const auto d : edges[s])
+      if ((*sets)[d].merge((*sets)[s]) && !queued[d]) {
+        queued[d] = true;
+        work.push_back(d);
+      }
+  }
+}
+
+void find_first(const rule_table &t, cfg::grammar_analysis *a) {
+  const auto n = a->symbols.size();
+  a->first.assign(n, cfg::symbol_set{n + 1});
+  for (auto s = a->nonterminals; s < n; ++s)
+    a->first[s].set(s);
+
+  // An edge from x to the left hand side of every rule x can start
+  std::vector<std::vector<cfg::symbol_id_t>> edges(a->nonterminals);
+  for (std::size_t r = 0; r < t.size(); ++r)
+    for (const auto x : t.get_rhs(r)) {
+      if (a->is_terminal(x)) {
+        a->first[t.lhs[r]].set(x);
+        break;
+      }
+      edges[x].push_back(t.lhs[r]);
+      if (!a->nullable.test(x))
+        break;
+    }
+
+  propagate(edges, &a->first);
+}
+
+void find_follow(const rule_table &t, cfg::grammar_analysis *a) {
+  a->follow.assign(a->nonterminals, cfg::symbol_set{a->symbols.size() + 1});
+  a->follow[a->start].set(a->end_of_input());
+
+  // An edge from the left hand side to every symbol that can end the rule
+  std::vector<std::vector<cfg::symbol_id_t>> edges(a->nonterminals);
+  for (std::size_t r = 0; r < t.size(); ++r) {
+    const auto rhs = t.get_rhs(r);
+    for (std::size_t i = 0; i < rhs.size(); ++i) {
+      if (a->is_terminal(rhs[i]))
+        continue;
+
+      auto &follow = a->follow[rhs[i]];
+      std::size_t j = i + 1;
+      for (; j < rhs.size(); ++j) {
+        follow.merge(a->first[rhs[j]]);
+        if (!a->nullable.test(rhs[j]))
+          break;
+      }
+      if (j == rhs.size())
+        edges[t.lhs[r]].push_back(rhs[i]);
+    }
+  }
+
+  propagate(edges, &a->follow);
+}
+} // namespace
+
+namespace cfg {
+result analyze(const std::vector<const rule *> *g, grammar_analysis *out,
+               analysis_set sets) {
+  if (!g || !g->size() || !out)
+    return result::format_error;
+
+  // FOLLOW needs FIRST, which needs the nullable symbols
+  if (bool(sets & analysis_set::follow))
+    sets = sets | analysis_set::first;
+  if (bool(sets & analysis_set::first))
+    sets = sets | analysis_set::nullable;
+
+  grammar_analysis a{.computed = sets};
+  const auto t = make_table(*g, &a);
+  const auto n = a.symbols.size();
+
+  if (a.has(analysis_set::nullable)) {
+    a.nullable = symbol_set{n};
+    close_over_rules(t, &a, &a.nullable);
+  }
+
+  if (a.has(analysis_set::productive)) {
+    a.productive = symbol_set{n};
+    for (auto s = a.nonterminals; s < n; ++s)
+      a.productive.set(s);
+    close_over_rules(t, &a, &a.productive);
+  }
+
+  if (a.has(analysis_set::reachable)) {
+    a.reachable = symbol_set{n};
+    find_reachable(t, &a);
+  }
+  if (a.has(analysis_set::first))
+    find_first(t, &a);
+  if (a.has(analysis_set::follow))
+    find_follow(t, &a);
+
+  *out = std::move(a);
+  return result::success;
+}
+
+result analyze(const grammar_t *g, grammar_analysis *out,
+               analysis_set sets) {
+  if (!g)
+    return result::format_error;
+
+  std::vector<const rule *> rules{};
+  rules.reserve(g->size());
+  for (const auto &r : *g)
+    rules.push_back(r.get());
+  return analyze(&rules, out, sets);
+}
+
+result remove_useless(grammar_t *g, useless_report *report) {
+  if (!g || !g->size())
+    return result::format_error;
+
+  grammar_analysis a{};
+  if (auto r = analyze(g, &a, analysis_set::productive); r != result::success)
+    return r;
+  if (!a.productive.test(a.start))
+    return result::match_failure;
+
+  const auto size = g->size();
+  std::vector<symbol_t> unproductive{};
+  for (std::size_t s = 0; s < a.nonterminals; ++s)
+    if (!a.productive.test(s))
+      unproductive.push_back(a.symbols[s]);
+
+  std::erase_if(*g, [&a](const auto &r) {
+    if (!a.productive.test(a.ids.at(r->lhs)))
+      return true;
+    return std::any_of(r->rhs.begin(), r->rhs.end(), [&a](const auto &s) {
+      return !a.productive.test(a.ids.at(s));
+    });
+  });
+
+  if (auto r = analyze(g, &a, analysis_set::reachable); r != result::success)
+    return r;
+
+  std::vector<symbol_t> unreachable{};
+  for (std::size_t s = 0; s < a.nonterminals; ++s)
+    if (!a.reachable.test(s))
+      unreachable.push_back(a.symbols[s]);
+
+  std::erase_if(*g, [&a](const auto &r) {
+    return !a.reachable.test(a.ids.at(r->lhs));
+  });
+
+  if (report) {
+    report->unproductive.insert(report->unproductive.end(),
+                                unproductive.begin(), unproductive.end());
+    report->unreachable.insert(report->unreachable.end(), unreachable.begin(),
+                               unreachable.end());
+    report->rules += size - g->size();
+  }
+  return result::success;
+}
+} // namespace cfg
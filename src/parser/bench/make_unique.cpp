@@ -0,0 +1,45 @@
+#include <cfgtk/parser.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace {
+// Every rule is repeated `copies` times, spread over the whole grammar
+cfg::grammar_t make_grammar(std::size_t rules, std::size_t copies) {
+  cfg::grammar_t g{};
+  g.reserve(rules * copies + 1);
+  cfg::add_rule(&g, "start", "nt0", "nt1");
+  for (std::size_t c = 0; c < copies; ++c)
+    for (std::size_t i = 0; i < rules; ++i)
+      cfg::add_rule(&g, "nt" + std::to_string(i % 997),
+                    "nt" + std::to_string((i * 31 + 7) % 997),
+                    "tok" + std::to_string(i));
+  return g;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t rules = argc > 1 ? std::stoull(argv[1]) : 50000;
+  const std::size_t copies = argc > 2 ? std::stoull(argv[2]) : 2;
+  const std::size_t rounds = argc > 3 ? std::stoull(argv[3]) : 5;
+
+  const auto input = make_grammar(rules, copies);
+  cfg::cnf_info info{};
+  info.filter = cfg::cnf_filter::unique0;
+
+  std::chrono::nanoseconds best{std::chrono::nanoseconds::max()};
+  std::size_t size{};
+  for (std::size_t i = 0; i < rounds; ++i) {
+    cfg::grammar_t out{};
+    const auto begin = std::chrono::steady_clock::now();
+    cfg::to_cnf(&input, &out, &info);
+    best = std::min(best, std::chrono::steady_clock::now() - begin);
+    size = out.size();
+  }
+
+  std::cout << "make_unique: " << input.size() << " -> " << size
+            << " rules, best of " << rounds << ": "
+            << std::chrono::duration<double, std::milli>(best).count()
+            << " ms\n";
+  return size == rules + 1 ? 0 : 1;
+}
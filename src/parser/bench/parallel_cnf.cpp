@@ -0,0 +1,55 @@
+#include <cfgtk/parser.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+// Long rules mixing terminals and nullable non-terminals, so that the term,
+// bin and del passes all have work on every rule
+cfg::grammar_t make_grammar(std::size_t rules) {
+  cfg::grammar_t g{};
+  g.reserve(rules + 1);
+  cfg::add_rule(&g, "start", "nt0");
+  for (std::size_t i = 0; i < rules; ++i) {
+    const auto nt = [](std::size_t k) { return "nt" + std::to_string(k); };
+    cfg::add_rule(&g, nt(i), "tok" + std::to_string(i % 101), nt(i + 1),
+                  nt((i * 7 + 3) % rules), "tok" + std::to_string(i % 37));
+    cfg::add_rule(&g, nt(i));
+  }
+  return g;
+}
+
+double convert(const cfg::grammar_t &input, std::size_t threads,
+               std::size_t rounds) {
+  cfg::cnf_info info{};
+  info.filter = cfg::cnf_filter::unique0 | cfg::cnf_filter::start |
+                cfg::cnf_filter::term | cfg::cnf_filter::bin |
+                cfg::cnf_filter::del;
+  info.threads = threads;
+
+  std::chrono::nanoseconds best{std::chrono::nanoseconds::max()};
+  for (std::size_t i = 0; i < rounds; ++i) {
+    cfg::grammar_t out{};
+    const auto begin = std::chrono::steady_clock::now();
+    cfg::to_cnf(&input, &out, &info);
+    best = std::min(best, std::chrono::steady_clock::now() - begin);
+  }
+  return std::chrono::duration<double, std::milli>(best).count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t rules = argc > 1 ? std::stoull(argv[1]) : 200000;
+  const std::size_t rounds = argc > 2 ? std::stoull(argv[2]) : 3;
+  const auto input = make_grammar(rules);
+
+  const auto serial = convert(input, 1, rounds);
+  std::cout << "to_cnf: " << input.size() << " rules, 1 thread: " << serial
+            << " ms\n";
+  for (std::size_t t = 2; t <= std::thread::hardware_concurrency(); t *= 2) {
+    const auto ms = convert(input, t, rounds);
+    std::cout << "to_cnf: " << t << " threads: " << ms
+              << " ms, speedup: " << serial / ms << '\n';
+  }
+}
@@ -0,0 +1,272 @@
+#include <cfgtk/parser.hpp>
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace {
+struct binary_entry {
+  std::size_t lhs{}, left{}, right{};
+};
+
+struct cyk_tables {
+  std::vector<cfg::symbol_t> symbols{};
+  std::unordered_map<cfg::symbol_t, std::size_t> index{};
+  // Token id -> every LHS that derives it, keyed by id length for the switch
+  std::map<std::size_t, std::map<cfg::symbol_t, std::vector<std::size_t>>>
+      terminals{};
+  // Left symbol -> right symbol -> every LHS that derives the pair
+  std::map<std::size_t, std::map<std::size_t, std::vector<std::size_t>>>
+      pairs{};
+  std::vector<binary_entry> binaries{};
+  bool accepts_empty{};
+};
+
+// The contents of a string literal spelling s; other bytes than printable
+// ASCII are written as octal escapes, which end after three digits
+std::string escape(const std::string &s) {
+  std::string out{};
+  for (const auto c : s) {
+    const auto u = static_cast<unsigned char>(c);
+    if (u < 0x20 || u > 0x7e) {
+      const char octal[]{'\\', char('0' + (u >> 6)),
+                         char('0' + ((u >> 3) & 7)), char('0' + (u & 7))};
+      out.append(octal, sizeof(octal));
+      continue;
+    }
+    if (c == '"' || c == '\\')
+      out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+// s for a comment, with the bytes that could end or continue it, like a
+// trailing backslash, and every other unprintable byte replaced by ?
+std::string sanitize(const std::string &s) {
+  std::string out{s};
+  for (auto &c : out) {
+    const auto u = static_cast<unsigned char>(c);
+    if (c == '\\' || u < 0x20 || u > 0x7e)
+      c = '?';
+  }
+  return out;
+}
+
+cyk_tables make_tables(const cfg::grammar_t *g) {
+  cyk_tables t{};
+  for (const auto &r : *g)
+    if (!t.index.contains(r->lhs)) {
+      t.index.emplace(r->lhs, t.symbols.size());
+      t.symbols.push_back(r->lhs);
+    }
+
+  const auto start = cfg::get_start(g);
+  for (const auto &r : *g) {
+    const auto lhs = t.index.at(r->lhs);
+    if (!r->rhs.size() && r->lhs == start)
+      t.accepts_empty = true;
+    else if (r->rhs.size() == 1) {
+      auto &e = t.terminals[r->rhs.front().size()][r->rhs.front()];
+      if (std::find(e.begin(), e.end(), lhs) == e.end())
+        e.push_back(lhs);
+    } else if (r->rhs.size() == 2 && t.index.contains(r->rhs.front()) &&
+               t.index.contains(r->rhs.back())) {
+      // A pair of symbols that never appear on a LHS cannot be matched
+      const auto left = t.index.at(r->rhs.front());
+      const auto right = t.index.at(r->rhs.back());
+      auto &e = t.pairs[left][right];
+      if (std::find(e.begin(), e.end(), lhs) != e.end())
+        continue;
+      e.push_back(lhs);
+      t.binaries.push_back({lhs, left, right});
+    }
+  }
+
+  std::stable_sort(
+      t.binaries.begin(), t.binaries.end(),
+      [](const auto &a, const auto &b) { return a.lhs < b.lhs; });
+  return t;
+}
+
+std::string make_set(const std::vector<std::size_t> &bits) {
+  std::string out{"symbol_set{}"};
+  for (const auto b : bits)
+    out += ".set(" + std::to_string(b) + ")";
+  return out;
+}
+
+void emit_prologue(std::stringstream &o, const cyk_tables &t,
+                   const cfg::cyk_encoding *e) {
+  if (e->include_guard)
+    o << "#pragma once\n\n";
+
+  o << "#include <bitset>\n"
+       "#include <cstddef>\n"
+       "#include <iterator>\n"
+       "#include <string_view>\n"
+       "#include <vector>\n\n";
+
+  o << "namespace " << e->namespace_name << " {\n";
+  o << "inline constexpr std::size_t symbol_count{" << t.symbols.size()
+    << "};\n";
+  o << "inline constexpr std::size_t start_symbol{0};\n";
+  o << "inline constexpr bool accepts_empty{"
+    << (t.accepts_empty ? "true" : "false") << "};\n";
+  o << "inline constexpr std::size_t npos{static_cast<std::size_t>(-1)};\n\n";
+
+  o << "using symbol_set = std::bitset<symbol_count>;\n";
+  o << "using chart_t = std::vector<symbol_set>;\n\n";
+
+  o << "inline constexpr std::string_view symbols[symbol_count]{\n";
+  for (const auto &s : t.symbols)
+    o << "    \"" << escape(s) << "\",\n";
+  o << "};\n\n";
+}
+
+void emit_binaries(std::stringstream &o, const cyk_tables &t) {
+  o << "struct binary_rule {\n"
+       "  std::size_t lhs{}, left{}, right{};\n"
+       "};\n\n";
+
+  o << "inline constexpr std::size_t binary_count{" << t.binaries.size()
+    << "};\n";
+  o << "inline constexpr binary_rule binary_rules[binary_count ? binary_count "
+       ": 1]{\n";
+  for (const auto &b : t.binaries)
+    o << "    {" << b.lhs << ", " << b.left << ", " << b.right << "},\n";
+  o << "};\n\n";
+
+  // Offsets of the first binary rule of every LHS, binary_rules being sorted
+  o << "inline constexpr std::size_t binary_offsets[symbol_count + 1]{";
+  std::size_t offset{};
+  for (std::size_t s = 0; s <= t.symbols.size(); ++s) {
+    while (offset < t.binaries.size() && t.binaries[offset].lhs < s)
+      ++offset;
+    o << offset << (s < t.symbols.size() ? ", " : "");
+  }
+  o << "};\n\n";
+}
+
+void emit_terminals(std::stringstream &o, const cyk_tables &t) {
+  o << "inline symbol_set match_terminal(std::string_view id) {\n"
+       "  switch (id.size()) {\n";
+  for (const auto &[size, ids] : t.terminals) {
+    o << "  case " << size << ":\n";
+    for (const auto &[id, lhs] : ids)
+      o << "    if (id == \"" << escape(id) << "\")\n"
+        << "      return " << make_set(lhs) << ";\n";
+    o << "    break;\n";
+  }
+  o << "  }\n"
+       "  return {};\n"
+       "}\n\n";
+}
+
+void emit_pairs(std::stringstream &o, const cyk_tables &t) {
+  o << "inline void match_pair(std::size_t left, const symbol_set &right,\n"
+       "                       symbol_set &out) {\n"
+       "  switch (left) {\n";
+  for (const auto &[left, rights] : t.pairs) {
+    o << "  case " << left << ": // " << sanitize(t.symbols[left]) << "\n";
+    for (const auto &[right, lhs] : rights) {
+      o << "    if (right[" << right << "])\n";
+      o << "      out |= " << make_set(lhs) << ";\n";
+    }
+    o << "    break;\n";
+  }
+  o << "  default:\n"
+       "    break;\n"
+       "  }\n"
+       "}\n\n";
+}
+
+void emit_parser(std::stringstream &o) {
+  o << "inline std::size_t cell(std::size_t n, std::size_t begin,\n"
+       "                        std::size_t length) {\n"
+       "  return (length - 1) * n + begin;\n"
+       "}\n\n";
+
+  o << "template <typename Sequence> chart_t parse(const Sequence &ids) {\n"
+       "  const std::size_t n = std::size(ids);\n"
+       "  chart_t c(n * n);\n"
+       "  std::size_t i{};\n"
+       "  for (const auto &id : ids)\n"
+       "    c[i++] = match_terminal(id);\n\n"
+       "  for (std::size_t len = 2; len <= n; ++len)\n"
+       "    for (std::size_t b = 0; b + len <= n; ++b) {\n"
+       "      auto &out = c[cell(n, b, len)];\n"
+       "      for (std::size_t k = 1; k < len; ++k) {\n"
+       "        const auto &l = c[cell(n, b, k)];\n"
+       "        const auto &r = c[cell(n, b + k, len - k)];\n"
+       "        if (l.none() || r.none())\n"
+       "          continue;\n"
+       "        for (std::size_t s = 0; s < symbol_count; ++s)\n"
+       "          if (l[s])\n"
+       "            match_pair(s, r, out);\n"
+       "      }\n"
+       "    }\n"
+       "  return c;\n"
+       "}\n\n";
+
+  o << "inline bool is_valid(const chart_t &c, std::size_t n) {\n"
+       "  return n ? c[cell(n, 0, n)][start_symbol] : accepts_empty;\n"
+       "}\n\n";
+
+  o << "template <typename Sequence> bool recognize(const Sequence &ids) {\n"
+       "  return is_valid(parse(ids), std::size(ids));\n"
+       "}\n\n";
+
+  o << "struct tree_node {\n"
+       "  std::size_t symbol{};\n"
+       "  std::size_t begin{}, end{};\n"
+       "  std::size_t head{npos}, tail{npos};\n"
+       "};\n\n";
+
+  // Walks the chart top-down, picking the first split and binary rule whose
+  // children are both present; the nodes are returned in pre-order.
+  o << "inline std::vector<tree_node> derive(const chart_t &c, std::size_t n) "
+       "{\n"
+       "  std::vector<tree_node> tree{};\n"
+       "  if (!n || !is_valid(c, n))\n"
+       "    return tree;\n\n"
+       "  tree.push_back({start_symbol, 0, n - 1});\n"
+       "  for (std::size_t i = 0; i < tree.size(); ++i) {\n"
+       "    const auto b = tree[i].begin, len = tree[i].end - b + 1;\n"
+       "    const auto sym = tree[i].symbol;\n"
+       "    for (std::size_t k = 1; k < len && tree[i].head == npos; ++k)\n"
+       "      for (auto r = binary_offsets[sym]; r < binary_offsets[sym + 1]; "
+       "++r) {\n"
+       "        const auto &e = binary_rules[r];\n"
+       "        if (c[cell(n, b, k)][e.left] &&\n"
+       "            c[cell(n, b + k, len - k)][e.right]) {\n"
+       "          tree[i].head = tree.size();\n"
+       "          tree.push_back({e.left, b, b + k - 1});\n"
+       "          tree[i].tail = tree.size();\n"
+       "          tree.push_back({e.right, b + k, b + len - 1});\n"
+       "          break;\n"
+       "        }\n"
+       "      }\n"
+       "  }\n"
+       "  return tree;\n"
+       "}\n";
+}
+} // namespace
+
+namespace cfg {
+std::string to_string(const grammar_t *g, const cyk_encoding *e) {
+  if (!g || !g->size() || !e || !e->namespace_name.size())
+    return {};
+
+  const auto tables = make_tables(g);
+  std::stringstream out{};
+
+  emit_prologue(out, tables, e);
+  emit_binaries(out, tables);
+  emit_terminals(out, tables);
+  emit_pairs(out, tables);
+  emit_parser(out);
+  out << "} // namespace " << e->namespace_name;
+
+  return out.str();
+}
+} // namespace cfg
@@ -0,0 +1,329 @@
+#include <cfgtk/parser.hpp>
+#include <detail/compiled_image.hpp>
+#include <detail/mapped_file.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace {
+using word_t = std::uint64_t;
+constexpr std::size_t word_bits{64};
+
+struct bit_chart {
+  std::size_t n{}, words{};
+  std::vector<word_t> cells{};
+
+  word_t *at(std::size_t begin, std::size_t length) {
+    return cells.data() + ((length - 1) * n + begin) * words;
+  }
+};
+
+inline void set(word_t *cell, std::size_t bit) {
+  cell[bit / word_bits] |= word_t{1} << (bit % word_bits);
+}
+
+inline bool test(const word_t *cell, std::size_t bit) {
+  return cell[bit / word_bits] & (word_t{1} << (bit % word_bits));
+}
+
+// Rules of the given size whose first right hand side symbol is s
+std::span<const cfg::compiled_rule> find_rules(const cfg::grammar_view *g,
+                                               std::uint32_t size,
+                                               cfg::symbol_id_t s) {
+  const auto less = [](const cfg::compiled_rule &r, const auto &key) {
+    return r.size < key.first || (r.size == key.first && r.rhs[0] < key.second);
+  };
+  const auto greater = [](const auto &key, const cfg::compiled_rule &r) {
+    return key.first < r.size || (key.first == r.size && key.second < r.rhs[0]);
+  };
+
+  const auto key = std::pair{size, s};
+  const auto b = std::lower_bound(g->index.begin(), g->index.end(), key, less);
+  const auto e = std::upper_bound(b, g->index.end(), key, greater);
+  return {b, e};
+}
+
+void combine(const cfg::grammar_view *g, const word_t *left,
+             const word_t *right, word_t *out, std::size_t words) {
+  for (std::size_t w = 0; w < words; ++w)
+    for (auto bits = left[w]; bits; bits &= bits - 1) {
+      const auto s = static_cast<cfg::symbol_id_t>(w * word_bits +
+                                                   std::countr_zero(bits));
+      for (const auto &r : find_rules(g, 2, s))
+        if (test(right, r.rhs[1]))
+          set(out, r.lhs);
+    }
+}
+} // namespace
+
+namespace cfg {
+bool recognize(const grammar_view *g, const token_sequence_t *t) {
+  if (!g || !t || !g->rules.size())
+    return false;
+
+  if (!t->size()) {
+    for (const auto &r : g->rules)
+      if (r.lhs == g->start && !r.size)
+        return true;
+    return false;
+  }
+
+  bit_chart c{t->size(), (g->symbols.size() + word_bits - 1) / word_bits};
+  c.cells.resize(c.n * c.n * c.words);
+
+  for (std::size_t i = 0; i < c.n; ++i)
+    if (const auto s = find_symbol(g, (*t)[i].id); s != no_symbol)
+      for (const auto &r : find_rules(g, 1, s))
+        set(c.at(i, 1), r.lhs);
+
+  for (std::size_t len = 2; len <= c.n; ++len)
+    for (std::size_t b = 0; b + len <= c.n; ++b)
+      for (std::size_t k = 1; k < len; ++k)
+        combine(g, c.at(b, k), c.at(b + k, len - k), c.at(b, len), c.words);
+
+  return test(c.at(0, c.n), g->start);
+}
+
+result to_grammar(const grammar_view *g, grammar_t *out) {
+  if (!g || !out)
+    return result::format_error;
+
+  out->reserve(out->size() + g->rules.size());
+  for (const auto &r : g->rules) {
+    auto *n = add_rule(out, symbol_t{get_symbol(g, r.lhs)});
+    n->rhs.reserve(r.size);
+    for (std::uint32_t i = 0; i < r.size; ++i)
+      n->rhs.emplace_back(get_symbol(g, r.rhs[i]));
+  }
+  return result::success;
+}
+} // namespace cfg
+
+namespace {
+bool by_rhs(const cfg::compiled_rule &a, const cfg::compiled_rule &b) {
+  if (a.size != b.size)
+    return a.size < b.size;
+  if (a.rhs[0] != b.rhs[0])
+    return a.rhs[0] < b.rhs[0];
+  if (a.rhs[1] != b.rhs[1])
+    return a.rhs[1] < b.rhs[1];
+  return a.lhs < b.lhs;
+}
+
+void make_view(cfg::compiled_grammar *c, cfg::symbol_id_t start) {
+  c->view = {.strings = {c->strings.data(), c->strings.size()},
+             .symbols = c->symbols,
+             .by_name = c->by_name,
+             .rules = c->rules,
+             .index = c->index,
+             .start = start};
+}
+} // namespace
+
+namespace cfg {
+result compile(const grammar_t *g, compiled_grammar *out) {
+  if (!g || !g->size() || !out)
+    return result::format_error;
+
+  compiled_grammar c{};
+  std::unordered_map<std::string_view, symbol_id_t> ids{};
+  const auto intern = [&c, &ids](const symbol_t &s) {
+    if (const auto it = ids.find(s); it != ids.end())
+      return it->second;
+    const auto id = static_cast<symbol_id_t>(c.symbols.size());
+    c.symbols.push_back({static_cast<std::uint32_t>(c.strings.size()),
+                         static_cast<std::uint32_t>(s.size())});
+    c.strings.insert(c.strings.end(), s.begin(), s.end());
+    ids.emplace(s, id);
+    return id;
+  };
+
+  c.rules.reserve(g->size());
+  for (const auto &r : *g) {
+    if (r->rhs.size() > 2)
+      return result::excessive_symbols;
+    compiled_rule n{.lhs = intern(r->lhs),
+                    .size = static_cast<std::uint32_t>(r->rhs.size())};
+    for (std::size_t i = 0; i < r->rhs.size(); ++i)
+      n.rhs[i] = intern(r->rhs[i]);
+    c.rules.push_back(n);
+  }
+
+  c.by_name.resize(c.symbols.size());
+  for (std::size_t i = 0; i < c.by_name.size(); ++i)
+    c.by_name[i] = static_cast<symbol_id_t>(i);
+  make_view(&c, 0);
+  std::sort(c.by_name.begin(), c.by_name.end(),
+            [&c](symbol_id_t a, symbol_id_t b) {
+              return get_symbol(&c.view, a) < get_symbol(&c.view, b);
+            });
+
+  c.index = c.rules;
+  std::sort(c.index.begin(), c.index.end(), by_rhs);
+  make_view(&c, 0);
+
+  *out = std::move(c);
+  return result::success;
+}
+} // namespace cfg
+
+namespace {
+// Every section starts at a multiple of this, so the loaded tables can be
+// used in place
+constexpr std::uint64_t section_alignment{8};
+constexpr char file_magic[8]{'C', 'F', 'G', 'T', 'K', 'C', 'G', '\0'};
+constexpr std::uint32_t byte_order_mark{0x01020304};
+
+struct file_header {
+  char magic[8]{};
+  std::uint32_t version{};
+  std::uint32_t byte_order{};
+  std::uint32_t symbol_count{};
+  std::uint32_t rule_count{};
+  std::uint32_t string_size{};
+  cfg::symbol_id_t start{};
+  std::uint64_t symbols{};
+  std::uint64_t by_name{};
+  std::uint64_t rules{};
+  std::uint64_t index{};
+  std::uint64_t strings{};
+};
+static_assert(std::is_trivially_copyable_v<file_header>);
+static_assert(std::is_trivially_copyable_v<cfg::compiled_rule>);
+static_assert(std::is_trivially_copyable_v<cfg::compiled_symbol>);
+
+std::uint64_t align(std::uint64_t offset) {
+  return (offset + section_alignment - 1) / section_alignment *
+         section_alignment;
+}
+
+template <typename T>
+const T *section(std::string_view file, std::uint64_t offset,
+                 std::uint64_t count) {
+  if (offset % alignof(T) || offset > file.size() ||
+      count > (file.size() - offset) / sizeof(T))
+    return nullptr;
+  return reinterpret_cast<const T *>(file.data() + offset);
+}
+
+// Checks that every reference stays inside the mapping and that the tables
+// the lookups binary search are in order, so that a corrupted file fails
+// instead of giving wrong answers; this only reads the tables and never
+// allocates.
+bool is_consistent(const cfg::grammar_view &v) {
+  const auto count = v.symbols.size();
+  for (const auto &s : v.symbols)
+    if (s.offset > v.strings.size() || s.size > v.strings.size() - s.offset)
+      return false;
+  for (const auto s : v.by_name)
+    if (s >= count)
+      return false;
+  for (const auto &set : {v.rules, v.index})
+    for (const auto &r : set)
+      if (r.lhs >= count || r.size > 2 || (r.size > 0 && r.rhs[0] >= count) ||
+          (r.size > 1 && r.rhs[1] >= count))
+        return false;
+
+  if (!std::is_sorted(v.index.begin(), v.index.end(), by_rhs))
+    return false;
+  // Names are unique, so they strictly ascend
+  for (std::size_t i = 1; i < v.by_name.size(); ++i)
+    if (cfg::get_symbol(&v, v.by_name[i - 1]) >=
+        cfg::get_symbol(&v, v.by_name[i]))
+      return false;
+  return v.start < count || !count;
+}
+} // namespace
+
+namespace cfg {
+std::string to_image(const grammar_view *g) {
+  file_header h{};
+  std::copy(std::begin(file_magic), std::end(file_magic), h.magic);
+  h.version = compiled_grammar_version;
+  h.byte_order = byte_order_mark;
+  h.symbol_count = static_cast<std::uint32_t>(g->symbols.size());
+  h.rule_count = static_cast<std::uint32_t>(g->rules.size());
+  h.string_size = static_cast<std::uint32_t>(g->strings.size());
+  h.start = g->start;
+  h.symbols = align(sizeof(file_header));
+  h.by_name = align(h.symbols + g->symbols.size_bytes());
+  h.rules = align(h.by_name + g->by_name.size_bytes());
+  h.index = align(h.rules + g->rules.size_bytes());
+  h.strings = align(h.index + g->index.size_bytes());
+
+  std::string data(h.strings + g->strings.size(), '\0');
+  const auto put = [&data](std::uint64_t offset, const auto *src,
+                           std::size_t bytes) {
+    if (bytes)
+      std::memcpy(data.data() + offset, src, bytes);
+  };
+  put(0, &h, sizeof(h));
+  put(h.symbols, g->symbols.data(), g->symbols.size_bytes());
+  put(h.by_name, g->by_name.data(), g->by_name.size_bytes());
+  put(h.rules, g->rules.data(), g->rules.size_bytes());
+  put(h.index, g->index.data(), g->index.size_bytes());
+  put(h.strings, g->strings.data(), g->strings.size());
+  return data;
+}
+
+result to_view(std::string_view file, grammar_view *out) {
+  file_header h{};
+  if (file.size() < sizeof(h))
+    return result::format_error;
+  std::memcpy(&h, file.data(), sizeof(h));
+
+  if (!std::equal(std::begin(file_magic), std::end(file_magic), h.magic) ||
+      h.version != compiled_grammar_version || h.byte_order != byte_order_mark)
+    return result::format_error;
+
+  const auto *symbols =
+      section<compiled_symbol>(file, h.symbols, h.symbol_count);
+  const auto *by_name = section<symbol_id_t>(file, h.by_name, h.symbol_count);
+  const auto *rules = section<compiled_rule>(file, h.rules, h.rule_count);
+  const auto *index = section<compiled_rule>(file, h.index, h.rule_count);
+  const auto *strings = section<char>(file, h.strings, h.string_size);
+  if (!symbols || !by_name || !rules || !index || !strings)
+    return result::format_error;
+
+  const grammar_view v{.strings = {strings, h.string_size},
+                       .symbols = {symbols, h.symbol_count},
+                       .by_name = {by_name, h.symbol_count},
+                       .rules = {rules, h.rule_count},
+                       .index = {index, h.rule_count},
+                       .start = h.start};
+  if (!is_consistent(v))
+    return result::format_error;
+  *out = v;
+  return result::success;
+}
+
+result write_to_file(const std::string &path, const grammar_view *g) {
+  if (!g)
+    return result::format_error;
+
+  const auto data = to_image(g);
+  std::ofstream str{path, std::ios::binary | std::ios::trunc};
+  if (!str.is_open())
+    return result::file_access_failure;
+  str.write(data.data(), static_cast<std::streamsize>(data.size()));
+  return str ? result::success : result::file_access_failure;
+}
+
+result read_from_file(const std::string &path, compiled_grammar *out) {
+  if (!out)
+    return result::format_error;
+
+  auto m = std::make_shared<mapped_file>();
+  if (map_file(path, m.get()) != map_status::mapped)
+    return result::file_access_failure;
+
+  compiled_grammar c{};
+  if (auto r = to_view(m->view(), &c.view); r != result::success)
+    return r;
+  c.mapping = std::move(m);
+  *out = std::move(c);
+  return result::success;
+}
+} // namespace cfg
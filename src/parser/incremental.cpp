@@ -0,0 +1,428 @@
+#include <cfgtk/analysis.hpp>
+#include <cfgtk/incremental.hpp>
+#include <algorithm>
+#include <unordered_set>
+
+namespace cfg {
+struct incremental_state {
+  struct entry {
+    rule source{};
+    bool alive{};
+    // What the term, bin and del steps made of the source rule; the only
+    // unit rules left point at non-terminals of the source grammar.
+    std::vector<rule> produced{};
+    // The output rules this entry accounts for
+    std::vector<std::string> keys{};
+  };
+
+  struct output_rule {
+    rule value{};
+    std::size_t count{};
+    std::size_t order{};
+  };
+
+  std::vector<entry> entries{};
+  // Derives the rules of the start symbol of the output
+  entry start{};
+  symbol_t source_start{};
+  symbol_t top{};
+  std::size_t first{};
+
+  // Rule counts by left hand side
+  std::unordered_map<symbol_t, std::size_t> definitions{};
+  std::unordered_set<symbol_t> nullable{};
+  // The non-terminals that reach a non-terminal through unit rules
+  std::unordered_map<symbol_t, std::vector<symbol_t>> unit_users{};
+  std::unordered_map<symbol_t, symbol_t> proxies{};
+
+  std::unordered_set<symbol_t> used{};
+  std::unordered_set<symbol_t> fresh{};
+  std::unordered_map<symbol_t, std::size_t> next{};
+
+  // Keyed by the rule, counting the entries that derive it
+  std::unordered_map<std::string, output_rule> output{};
+  std::size_t order{};
+};
+
+incremental_grammar::incremental_grammar()
+    : state{std::make_unique<incremental_state>()} {}
+
+incremental_grammar::~incremental_grammar() = default;
+} // namespace cfg
+
+namespace {
+using state_t = cfg::incremental_state;
+using entry_t = cfg::incremental_state::entry;
+
+bool is_nonterminal(const state_t *s, const cfg::symbol_t &x) {
+  const auto it = s->definitions.find(x);
+  return it != s->definitions.end() && it->second;
+}
+
+bool is_nullable(const state_t *s, const cfg::symbol_t &x) {
+  return s->nullable.contains(x);
+}
+
+bool is_unit(const state_t *s, const cfg::rule &r) {
+  return r.rhs.size() == 1 && is_nonterminal(s, r.rhs[0]);
+}
+
+bool all_nullable(const state_t *s, const std::vector<cfg::symbol_t> &rhs) {
+  return std::all_of(rhs.begin(), rhs.end(),
+                     [s](const auto &x) { return is_nullable(s, x); });
+}
+
+cfg::symbol_t make_name(state_t *s, const cfg::symbol_t &prefix) {
+  const auto base = prefix.substr(0, prefix.find('#')) + '#';
+  auto &next = s->next[base];
+  cfg::symbol_t id{};
+  do
+    id = base + std::to_string(next++);
+  while (s->used.contains(id));
+  s->used.insert(id);
+  s->fresh.insert(id);
+  return id;
+}
+
+std::string make_key(const cfg::rule &r) {
+  std::string key{r.lhs};
+  for (const auto &x : r.rhs) {
+    key += '\0';
+    key += x;
+  }
+  return key;
+}
+
+// The term, bin and del steps for a single rule. Unit rules the del step
+// makes towards the fresh non-terminals of the chain are replaced by the
+// rules of those, so they never reach the unit step.
+void produce(state_t *s, const cfg::rule &src, std::vector<cfg::rule> *out) {
+  const auto &rhs = src.rhs;
+  if (rhs.size() < 2) {
+    // Empty rules are accounted for by nullable and the start entry
+    if (rhs.size() == 1)
+      out->push_back(src);
+    return;
+  }
+
+  auto symbols = rhs;
+  for (auto &x : symbols)
+    if (!is_nonterminal(s, x)) {
+      auto &proxy = s->proxies[x];
+      if (proxy.empty())
+        proxy = make_name(s, x);
+      out->push_back({proxy, {x}});
+      x = proxy;
+    }
+
+  const auto n = symbols.size();
+  std::vector<cfg::symbol_t> names(n - 1);
+  names[0] = src.lhs;
+  for (std::size_t i = 1; i + 1 < n; ++i)
+    names[i] = make_name(s, src.lhs);
+
+  // Right hand sides of the chain link i, derived from the last link on
+  std::vector<std::vector<std::vector<cfg::symbol_t>>> links(n - 1);
+  bool suffix_nullable{is_nullable(s, rhs[n - 1])};
+  for (std::size_t i = n - 1; i-- > 0;) {
+    const bool last = i + 2 == n;
+    auto &link = links[i];
+    link.push_back({symbols[i], last ? symbols[i + 1] : names[i + 1]});
+    if (is_nullable(s, rhs[i])) {
+      if (last)
+        link.push_back({rhs[i + 1]});
+      else
+        link.insert(link.end(), links[i + 1].begin(), links[i + 1].end());
+    }
+    if (suffix_nullable)
+      link.push_back({rhs[i]});
+    suffix_nullable = suffix_nullable && is_nullable(s, rhs[i]);
+  }
+
+  for (std::size_t i = 0; i < links.size(); ++i)
+    for (auto &r : links[i])
+      out->push_back({names[i], std::move(r)});
+}
+
+void add_output(state_t *s, entry_t *e, cfg::rule r) {
+  auto key = make_key(r);
+  auto [it, inserted] = s->output.try_emplace(key);
+  if (inserted) {
+    it->second.value = std::move(r);
+    it->second.order = s->order++;
+  }
+  ++it->second.count;
+  e->keys.push_back(std::move(key));
+}
+
+// The unit step: the non-unit rules of an entry also go to every
+// non-terminal that reaches their left hand side through unit rules
+void emit(state_t *s, entry_t *e) {
+  for (const auto &r : e->produced) {
+    if (is_unit(s, r))
+      continue;
+    add_output(s, e, r);
+    if (const auto it = s->unit_users.find(r.lhs);
+        !r.rhs.empty() && it != s->unit_users.end())
+      for (const auto &user : it->second)
+        add_output(s, e, {user, r.rhs});
+  }
+}
+
+void withdraw(state_t *s, entry_t *e) {
+  for (const auto &key : e->keys)
+    if (const auto it = s->output.find(key); !--it->second.count)
+      s->output.erase(it);
+  e->keys.clear();
+  e->produced.clear();
+}
+
+bool has_units(const state_t *s, const entry_t *e) {
+  return std::any_of(e->produced.begin(), e->produced.end(),
+                     [s](const auto &r) { return is_unit(s, r); });
+}
+
+void find_unit_users(state_t *s) {
+  std::unordered_map<cfg::symbol_t, std::vector<cfg::symbol_t>> edges{};
+  const auto add_edges = [s, &edges](const entry_t &e) {
+    for (const auto &r : e.produced)
+      if (is_unit(s, r))
+        edges[r.lhs].push_back(r.rhs[0]);
+  };
+  add_edges(s->start);
+  for (const auto &e : s->entries)
+    add_edges(e);
+
+  for (const auto &[from, to] : edges) {
+    std::unordered_set<cfg::symbol_t> seen{from};
+    std::vector<cfg::symbol_t> stack{to};
+    while (!stack.empty()) {
+      auto x = std::move(stack.back());
+      stack.pop_back();
+      if (!seen.insert(x).second)
+        continue;
+      s->unit_users[x].push_back(from);
+      if (const auto it = edges.find(x); it != edges.end())
+        stack.insert(stack.end(), it->second.begin(), it->second.end());
+    }
+  }
+}
+
+void convert(cfg::incremental_grammar *g) {
+  auto *s = g->state.get();
+  auto entries = std::move(s->entries);
+  *s = {};
+  s->entries = std::move(entries);
+  for (auto &e : s->entries) {
+    e.produced.clear();
+    e.keys.clear();
+  }
+  ++g->stats.full;
+
+  std::vector<const cfg::rule *> alive{};
+  for (std::size_t i = 0; i < s->entries.size(); ++i)
+    if (const auto &e = s->entries[i]; e.alive) {
+      if (alive.empty())
+        s->first = i;
+      alive.push_back(&e.source);
+      ++s->definitions[e.source.lhs];
+      s->used.insert(e.source.lhs);
+      s->used.insert(e.source.rhs.begin(), e.source.rhs.end());
+    }
+  if (alive.empty())
+    return;
+
+  cfg::grammar_analysis a{};
+  cfg::analyze(&alive, &a, cfg::analysis_set::nullable);
+  for (std::size_t i = 0; i < a.nonterminals; ++i)
+    if (a.nullable.test(i))
+      s->nullable.insert(a.symbols[i]);
+
+  s->source_start = alive.front()->lhs;
+  const bool on_rhs = std::any_of(alive.begin(), alive.end(), [s](auto *r) {
+    return std::find(r->rhs.begin(), r->rhs.end(), s->source_start) !=
+           r->rhs.end();
+  });
+  s->top = on_rhs ? make_name(s, s->source_start) : s->source_start;
+
+  s->start.alive = true;
+  if (on_rhs)
+    s->start.produced.push_back({s->top, {s->source_start}});
+  if (is_nullable(s, s->source_start))
+    s->start.produced.push_back({s->top, {}});
+
+  for (auto &e : s->entries)
+    if (e.alive)
+      produce(s, e.source, &e.produced);
+  find_unit_users(s);
+
+  emit(s, &s->start);
+  for (auto &e : s->entries)
+    if (e.alive)
+      emit(s, &e);
+}
+
+// Whether adding the rule leaves the non-terminals, the nullable symbols
+// and the start rules of the grammar as they are
+bool can_add(const state_t *s, const cfg::rule &r) {
+  if (!is_nonterminal(s, r.lhs) || s->fresh.contains(r.lhs))
+    return false;
+  for (const auto &x : r.rhs)
+    if (s->fresh.contains(x) || (x == s->source_start && s->top == x))
+      return false;
+  return is_nullable(s, r.lhs) || !all_nullable(s, r.rhs);
+}
+
+bool can_remove(const state_t *s, std::size_t handle, bool same_lhs) {
+  const auto &e = s->entries[handle];
+  if ((s->first == handle && !same_lhs) ||
+      (s->definitions.at(e.source.lhs) < 2 && !same_lhs))
+    return false;
+  return !all_nullable(s, e.source.rhs) && !has_units(s, &e);
+}
+
+bool is_handle(const state_t *s, cfg::rule_handle_t h) {
+  return h < s->entries.size() && s->entries[h].alive;
+}
+
+// Derives the rules of an alive entry without a full conversion if it can;
+// define counts its rule among the rules of its left hand side.
+bool try_add(state_t *s, entry_t *e, bool define) {
+  if (!can_add(s, e->source))
+    return false;
+
+  // The symbols of the rule are taken before any fresh name is made, so
+  // that no name collides with them
+  std::vector<cfg::symbol_t> taken{};
+  const auto take = [s, &taken](const cfg::symbol_t &x) {
+    if (s->used.insert(x).second)
+      taken.push_back(x);
+  };
+  take(e->source.lhs);
+  for (const auto &x : e->source.rhs)
+    take(x);
+
+  produce(s, e->source, &e->produced);
+  if (has_units(s, e)) {
+    e->produced.clear();
+    for (const auto &x : taken)
+      s->used.erase(x);
+    return false;
+  }
+  if (define)
+    ++s->definitions[e->source.lhs];
+  emit(s, e);
+  return true;
+}
+} // namespace
+
+namespace cfg {
+result to_cnf(const grammar_t *input, incremental_grammar *g) {
+  if (!input || !input->size() || !g)
+    return result::format_error;
+
+  auto *s = g->state.get();
+  s->entries.clear();
+  s->entries.reserve(input->size());
+  for (const auto &r : *input)
+    s->entries.push_back({.source = *r, .alive = true});
+  convert(g);
+  return result::success;
+}
+
+result add_rule(incremental_grammar *g, rule r, rule_handle_t *handle) {
+  if (!g || r.lhs.empty())
+    return result::format_error;
+
+  auto *s = g->state.get();
+  if (handle)
+    *handle = s->entries.size();
+  s->entries.push_back({.source = std::move(r), .alive = true});
+  if (s->entries.size() > 1 && try_add(s, &s->entries.back(), true))
+    ++g->stats.partial;
+  else
+    convert(g);
+  return result::success;
+}
+
+result remove_rule(incremental_grammar *g, rule_handle_t handle) {
+  if (!g || !is_handle(g->state.get(), handle))
+    return result::match_failure;
+
+  auto *s = g->state.get();
+  auto &e = s->entries[handle];
+  if (can_remove(s, handle, false)) {
+    withdraw(s, &e);
+    e.alive = false;
+    --s->definitions[e.source.lhs];
+    ++g->stats.partial;
+  } else {
+    e.alive = false;
+    convert(g);
+  }
+  return result::success;
+}
+
+result replace_rule(incremental_grammar *g, rule_handle_t handle, rule r) {
+  if (!g || !is_handle(g->state.get(), handle))
+    return result::match_failure;
+  if (r.lhs.empty())
+    return result::format_error;
+
+  auto *s = g->state.get();
+  auto &e = s->entries[handle];
+  const bool same_lhs = e.source.lhs == r.lhs;
+  if (can_remove(s, handle, same_lhs)) {
+    withdraw(s, &e);
+    if (!same_lhs)
+      --s->definitions[e.source.lhs];
+    e.source = std::move(r);
+    if (try_add(s, &e, !same_lhs)) {
+      ++g->stats.partial;
+      return result::success;
+    }
+  } else
+    e.source = std::move(r);
+  convert(g);
+  return result::success;
+}
+
+result get_grammar(const incremental_grammar *g, grammar_t *out) {
+  if (!g || !out)
+    return result::format_error;
+
+  const auto *s = g->state.get();
+  std::vector<const incremental_state::output_rule *> rules{};
+  rules.reserve(s->output.size());
+  for (const auto &[key, r] : s->output)
+    rules.push_back(&r);
+  std::sort(rules.begin(), rules.end(), [s](auto *a, auto *b) {
+    const bool ta = a->value.lhs == s->top, tb = b->value.lhs == s->top;
+    return ta != tb ? ta : a->order < b->order;
+  });
+
+  out->clear();
+  out->reserve(rules.size());
+  for (const auto *r : rules)
+    add_rule(out, r->value.lhs, r->value.rhs);
+  return result::success;
+}
+
+result publish(incremental_grammar *g) {
+  if (!g)
+    return result::format_error;
+
+  grammar_t cnf{};
+  get_grammar(g, &cnf);
+  compiled_grammar c{};
+  if (auto r = compile(&cnf, &c); r != result::success)
+    return r;
+  g->snapshot.store(std::make_shared<const compiled_grammar>(std::move(c)));
+  return result::success;
+}
+
+std::shared_ptr<const compiled_grammar>
+get_snapshot(const incremental_grammar *g) {
+  return g ? g->snapshot.load() : nullptr;
+}
+} // namespace cfg
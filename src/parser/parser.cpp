@@ -1,10 +1,21 @@
+#include <cfgtk/analysis.hpp>
 #include <cfgtk/parser.hpp>
-#include <cmath>
+#include <detail/compiled_image.hpp>
+#include <detail/mapped_file.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <optional>
 #include <random>
-#include <regex>
 #include <set>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 namespace {
 using grammar_list_t =
@@ -12,6 +23,34 @@ using grammar_list_t =
 }
 
 namespace {
+// 64-bit FNV-1a; stable across processes and platforms, unlike std::hash
+struct stable_hash {
+  void add(std::string_view s) {
+    for (const auto c : s) {
+      value ^= static_cast<unsigned char>(c);
+      value *= 0x100000001b3;
+    }
+  }
+
+  void add(std::uint64_t v) {
+    for (std::size_t i = 0; i < sizeof(v); ++i) {
+      value ^= (v >> (i * 8)) & 0xff;
+      value *= 0x100000001b3;
+    }
+  }
+
+  std::uint64_t value{0xcbf29ce484222325};
+};
+
+// splitmix64 finalizer; spreads rule hashes before they are combined
+std::uint64_t mix(std::uint64_t v) {
+  v ^= v >> 30;
+  v *= 0xbf58476d1ce4e5b9;
+  v ^= v >> 27;
+  v *= 0x94d049bb133111eb;
+  return v ^ (v >> 31);
+}
+
 inline std::size_t make_random(std::size_t begin, std::size_t end) {
   static thread_local std::mt19937 rng{std::random_device{}()};
   return begin + rng() % end;
@@ -32,7 +71,10 @@ cartesian_product(C<cfg::chart_node> &A, C<cfg::chart_node> &B) {
   return p;
 }
 
-void recognize(const cfg::grammar_t *g, const cfg::token_t &s,
+// Leaves copy the values of owning tokens; those of token references are
+// found through the token index instead
+template <typename Token>
+void recognize(const cfg::grammar_t *g, const Token &s,
                const cfg::action_map_t *m, const std::size_t i,
                std::list<cfg::chart_node> &nodes) {
 
@@ -40,7 +82,8 @@ void recognize(const cfg::grammar_t *g, const cfg::token_t &s,
     if (r->rhs.size() == 1 && r->rhs.front() == s.id) {
       nodes.push_back({});
       auto &b = nodes.back();
-      b.value = s.value;
+      if constexpr (std::same_as<Token, cfg::token_t>)
+        b.value = s.value;
       b.rule = {.entry = r.get(), .tokens = {i, i}};
 
       if (m && m->contains(r.get()))
@@ -101,7 +144,8 @@ bool handle_early_exit(const cfg::grammar_t *g, const std::size_t tok_size,
   return true;
 }
 
-bool initialize(const cfg::grammar_t *g, const cfg::token_sequence_t *t,
+template <typename Token>
+bool initialize(const cfg::grammar_t *g, const std::vector<Token> *t,
                 const cfg::action_map_t *m, cfg::chart_t &c) {
   if (handle_early_exit(g, t->size(), c, m))
     return false;
@@ -136,10 +180,11 @@ void parse_cyk_iteration(const cfg::grammar_t *g, const std::size_t row,
 }
 } // namespace
 
-namespace cfg {
-chart_t cyk(const grammar_t *g, const token_sequence_t *t,
-            const action_map_t *m) {
-  chart_t c{};
+namespace {
+template <typename Token>
+cfg::chart_t run_cyk(const cfg::grammar_t *g, const std::vector<Token> *t,
+                     const cfg::action_map_t *m) {
+  cfg::chart_t c{};
 
   if (g && initialize(g, t, m, c))
     for (std::size_t row = 0; row < c.size(); ++row)
@@ -149,6 +194,18 @@ chart_t cyk(const grammar_t *g, const token_sequence_t *t,
 
   return c;
 }
+} // namespace
+
+namespace cfg {
+chart_t cyk(const grammar_t *g, const token_sequence_t *t,
+            const action_map_t *m) {
+  return run_cyk(g, t, m);
+}
+
+chart_t cyk(const grammar_t *g, const std::vector<token_ref> *t,
+            const action_map_t *m) {
+  return run_cyk(g, t, m);
+}
 
 bool is_valid(const chart_t *c, const symbol_t &start) {
   if (c && c->size()) {
@@ -196,6 +253,78 @@ bool is_equal(const grammar_t *g1, const grammar_t *g2) {
   return true;
 }
 
+std::size_t get_size(const grammar_t *g) {
+  std::size_t size{};
+  if (g)
+    for (const auto &r : *g)
+      size += 1 + r->rhs.size();
+  return size;
+}
+
+std::uint64_t get_hash(const rule *r) {
+  stable_hash h{};
+  h.add(r->lhs.size());
+  h.add(r->lhs);
+  h.add(r->rhs.size());
+  for (const auto &s : r->rhs) {
+    h.add(s.size());
+    h.add(s);
+  }
+  return mix(h.value);
+}
+
+void add_rule(grammar_hash *h, const rule *r) {
+  const auto v = get_hash(r);
+  if (h->mode == hash_mode::ordered)
+    h->value = mix(h->value + v);
+  else
+    h->value += v;
+  ++h->size;
+}
+
+result remove_rule(grammar_hash *h, const rule *r) {
+  if (h->mode != hash_mode::unordered || !h->size)
+    return result::bad_arg_type;
+  h->value -= get_hash(r);
+  --h->size;
+  return result::success;
+}
+
+grammar_hash get_hash(const grammar_t *g, hash_mode m) {
+  grammar_hash h{.mode = m};
+  if (g)
+    for (const auto &r : *g)
+      add_rule(&h, r.get());
+  return h;
+}
+
+bool is_equal(const grammar_hash *a, const grammar_hash *b) {
+  return a->mode == b->mode && a->size == b->size && a->value == b->value;
+}
+
+bool is_equal(const grammar_t *g1, const grammar_t *g2, hash_mode m) {
+  if (m == hash_mode::ordered)
+    return is_equal(g1, g2);
+  if (g1->size() != g2->size())
+    return false;
+
+  // Match every rule of g2 against a not yet matched, equal rule of g1
+  std::unordered_multimap<std::uint64_t, const rule *> pending{};
+  pending.reserve(g1->size());
+  for (const auto &r : *g1)
+    pending.emplace(get_hash(r.get()), r.get());
+
+  for (const auto &r : *g2) {
+    auto [b, e] = pending.equal_range(get_hash(r.get()));
+    while (b != e && !is_equal(b->second, r.get()))
+      ++b;
+    if (b == e)
+      return false;
+    pending.erase(b);
+  }
+  return true;
+}
+
 } // namespace cfg
 
 namespace {
@@ -319,64 +448,93 @@ std::string to_string(const cfg::chart_t *c) {
 
 namespace {
 
-template <typename G>
-std::size_t count_sym(const G &grammar, const cfg::symbol_t &s) {
-  std::size_t occ{};
-  for (const auto &r : grammar) {
-    if (r->lhs == s)
-      ++occ;
-    for (const auto &sym : r->rhs)
-      if (sym == s)
-        ++occ;
-  }
+// Rules below this many per thread are not worth splitting
+constexpr std::size_t min_chunk{1024};
 
-  return occ;
+std::size_t get_chunks(std::size_t size, std::size_t threads) {
+  return std::max<std::size_t>(1, std::min(threads, size / min_chunk));
 }
 
-template <typename G>
-std::size_t count_sym(const G &grammar, const std::regex &s) {
-  std::size_t occ{};
-  for (const auto &r : grammar) {
-    if (std::regex_match(r->lhs, s))
-      ++occ;
-    for (const auto &sym : r->rhs)
-      if (std::regex_match(sym, s))
-        ++occ;
-  }
+// Calls f(chunk, begin, end) for every one of the given number of equal
+// chunks of [0, size); the first chunk runs on the calling thread.
+template <typename F>
+void parallel_for(std::size_t size, std::size_t chunks, const F &f) {
+  const auto bound = [size, chunks](std::size_t c) {
+    return size * c / chunks;
+  };
 
-  return occ;
+  std::vector<std::jthread> pool{};
+  pool.reserve(chunks - 1);
+  for (std::size_t c = 1; c < chunks; ++c)
+    pool.emplace_back([&f, c, b = bound(c), e = bound(c + 1)] { f(c, b, e); });
+  f(0, bound(0), bound(1));
 }
 
-template <template <typename> typename C, typename T>
-  requires requires(T t) {
-    requires std::convertible_to<std::string, decltype(t->lhs)>;
+std::vector<cfg::rule *> get_rules(grammar_list_t &glist) {
+  std::vector<cfg::rule *> out{};
+  out.reserve(glist.size());
+  for (auto &r : glist)
+    out.push_back(r.get());
+  return out;
+}
+
+// Hands out symbol names that do not occur in the grammar it was built
+// from, nor among the names it returned before. A name such as "a#3" is
+// continued from its number, any other name gets a "#k" postfix.
+class symbol_allocator {
+public:
+  template <typename G> explicit symbol_allocator(const G &grammar) {
+    for (const auto &r : grammar) {
+      add(r->lhs);
+      for (const auto &s : r->rhs)
+        add(s);
+    }
   }
-std::string make_unique_id(const C<T> &c, std::string prefix, bool random) {
-  using std::stoull;
-  auto hashpos = std::find(prefix.begin(), prefix.end(), '#');
-  const bool hash = hashpos != prefix.end();
-  const auto oc = count_sym(c, std::regex{"^" + prefix + ".*$"});
-  const std::size_t idlen = oc ? std::log10(oc) + 1 : 1;
-  static const std::string sset{"0123456789"};
-  std::size_t index{hash ? stoull(std::string{++hashpos, prefix.end()}) : 0};
-  std::string id{};
-
-  if (hash)
-    while (hashpos != prefix.end())
-      prefix.pop_back();
-
-  do {
-    std::string postfix{hash ? "" : "#"};
-    if (random)
-      for (std::size_t i = 0; i < idlen; ++i)
-        postfix += sset[make_random(0, sset.size())];
-    else
-      postfix += std::to_string(index++);
-    id = prefix + postfix;
-  } while (count_sym(c, id));
 
-  return id;
-}
+  std::string make(const std::string &prefix, bool random) {
+    const auto hashpos = prefix.find('#');
+    std::string base{prefix.substr(0, hashpos)};
+    std::size_t index{};
+    if (hashpos != std::string::npos)
+      std::from_chars(prefix.data() + hashpos + 1,
+                      prefix.data() + prefix.size(), index);
+    base += '#';
+
+    std::string id{};
+    if (random) {
+      // Ten times more names than the base has, so few draws are needed
+      const auto count = counts[base] + 1;
+      const std::size_t idlen = std::to_string(count).size() + 1;
+      do {
+        id = base;
+        for (std::size_t i = 0; i < idlen; ++i)
+          id += static_cast<char>('0' + make_random(0, 10));
+      } while (used.contains(id));
+    } else {
+      // Names are never released, so the next free index only grows
+      auto &next = memo.try_emplace(base + std::to_string(index), index)
+                       .first->second;
+      do
+        id = base + std::to_string(next++);
+      while (used.contains(id));
+    }
+
+    add(id);
+    return id;
+  }
+
+private:
+  void add(const std::string &s) {
+    if (used.insert(s).second)
+      ++counts[s.substr(0, s.find('#')) + '#'];
+  }
+
+  std::unordered_set<std::string> used{};
+  // Number of known names per base, sizing random postfixes
+  std::unordered_map<std::string, std::size_t> counts{};
+  // Next index to try per base and starting index
+  std::unordered_map<std::string, std::size_t> memo{};
+};
 } // namespace
 
 namespace {
@@ -423,70 +581,181 @@ void rm_unreachable_nterms(grammar_list_t &glist,
   }
 }
 
-std::set<cfg::symbol_t> get_nullable(grammar_list_t &glist) {
-  const auto start = cfg::get_start(&glist);
-  std::set<cfg::symbol_t> nullable{};
+struct rhs_hash {
+  std::size_t operator()(const std::vector<cfg::symbol_t> *rhs) const {
+    std::size_t h{rhs->size()};
+    for (const auto &s : *rhs)
+      h = h * 31 + std::hash<cfg::symbol_t>{}(s);
+    return h;
+  }
+};
 
-  for (const auto &rule : glist)
-    if (rule->lhs != start && !rule->rhs.size())
-      nullable.emplace(rule->lhs);
+struct rhs_equal {
+  bool operator()(const std::vector<cfg::symbol_t> *a,
+                  const std::vector<cfg::symbol_t> *b) const {
+    return *a == *b;
+  }
+};
 
-  for (const auto &rule : glist) {
-    bool append{true};
-    for (const auto &sym : rule->rhs)
-      if (!nullable.contains(sym)) {
-        append = false;
-        break;
-      }
+using rhs_set_t =
+    std::unordered_set<const std::vector<cfg::symbol_t> *, rhs_hash, rhs_equal>;
+
+// The non-unit productions every non-terminal derives through unit rules,
+// itself included. Strongly connected components of the unit graph share a
+// list; Tarjan's algorithm finishes a component only after every component
+// it reaches, so each list is built once from lists that are complete.
+class unit_closure {
+public:
+  unit_closure(const grammar_list_t &glist,
+               const std::set<cfg::symbol_t> &nterms)
+      : nterms{&nterms} {
+    for (const auto &r : glist) {
+      const auto [it, added] = ids.try_emplace(r->lhs, rules.size());
+      if (added)
+        rules.emplace_back();
+      rules[it->second].push_back(r.get());
+    }
 
-    if (append)
-      nullable.emplace(rule->lhs);
+    index.resize(rules.size(), npos);
+    low.resize(rules.size());
+    on_stack.resize(rules.size());
+    component.resize(rules.size(), npos);
+    for (std::size_t v = 0; v < rules.size(); ++v)
+      if (index[v] == npos)
+        visit(v);
   }
 
-  return nullable;
-}
+  bool is_unit(const cfg::rule *r) const {
+    return r->rhs.size() == 1 && nterms->contains(r->rhs.front());
+  }
 
-std::vector<std::vector<cfg::symbol_t>>
-get_rhs(const grammar_list_t &glist, const std::string lhs,
-        const std::vector<cfg::symbol_t> &exclude) {
-  std::vector<std::vector<cfg::symbol_t>> out{};
+  std::size_t get_id(const cfg::symbol_t &s) const { return ids.at(s); }
 
-  for (const auto &rule : glist) {
-    bool ok{true};
-    for (const auto &e : exclude) {
-      if (rule->rhs.size() == 1 && rule->rhs.front() == e) {
-        ok = false;
-        break;
+  const std::vector<const cfg::rule *> &get(const cfg::symbol_t &s) const {
+    return productions[component[ids.at(s)]];
+  }
+
+  const std::vector<const cfg::rule *> &get_rules(std::size_t v) const {
+    return rules[v];
+  }
+
+  std::size_t size() const { return rules.size(); }
+
+private:
+  static constexpr std::size_t npos{static_cast<std::size_t>(-1)};
+
+  struct frame {
+    std::size_t v{}, next{};
+  };
+
+  std::size_t target(const cfg::rule *r) const {
+    return is_unit(r) ? ids.at(r->rhs.front()) : npos;
+  }
+
+  // Iterative, since unit chains can be deeper than the call stack
+  void visit(std::size_t root) {
+    std::vector<frame> calls{{root}};
+    open(root);
+    while (calls.size()) {
+      auto &f = calls.back();
+      if (f.next < rules[f.v].size()) {
+        const auto w = target(rules[f.v][f.next++]);
+        if (w == npos)
+          continue;
+        if (index[w] == npos) {
+          open(w);
+          calls.push_back({w});
+        } else if (on_stack[w])
+          low[f.v] = std::min(low[f.v], index[w]);
+        continue;
       }
+
+      const auto v = f.v;
+      calls.pop_back();
+      if (calls.size())
+        low[calls.back().v] = std::min(low[calls.back().v], low[v]);
+      if (low[v] == index[v])
+        close(v);
     }
+  }
 
-    if (rule->lhs == lhs && ok)
-      out.push_back(rule->rhs);
+  void open(std::size_t v) {
+    index[v] = low[v] = counter++;
+    stack.push_back(v);
+    on_stack[v] = true;
   }
 
-  return out;
-}
+  void close(std::size_t root) {
+    std::vector<std::size_t> members{};
+    std::size_t v{};
+    do {
+      v = stack.back();
+      stack.pop_back();
+      on_stack[v] = false;
+      component[v] = productions.size();
+      members.push_back(v);
+    } while (v != root);
+    std::sort(members.begin(), members.end());
+
+    std::vector<const cfg::rule *> out{};
+    rhs_set_t seen{};
+    const auto add = [&out, &seen](const cfg::rule *r) {
+      if (seen.insert(&r->rhs).second)
+        out.push_back(r);
+    };
+
+    for (const auto m : members)
+      for (const auto *r : rules[m]) {
+        const auto w = target(r);
+        if (w == npos)
+          add(r);
+        else if (component[w] != productions.size())
+          for (const auto *p : productions[component[w]])
+            add(p);
+      }
+    productions.push_back(std::move(out));
+  }
+
+  const std::set<cfg::symbol_t> *nterms{};
+  std::unordered_map<cfg::symbol_t, std::size_t> ids{};
+  std::vector<std::vector<const cfg::rule *>> rules{};
+  std::vector<std::vector<const cfg::rule *>> productions{};
+  std::vector<std::size_t> index{}, low{}, component{}, stack{};
+  std::vector<bool> on_stack{};
+  std::size_t counter{};
+};
 } // namespace
 
 namespace cfg {
 // Eliminate duplicate rule definitions while preserving
-// the first definition of the start symbol.
+// the first definition of the start symbol. Of every other
+// group of duplicates only the last definition is kept.
 void make_unique(grammar_list_t &glist) {
+  if (glist.empty())
+    return;
+
+  const auto hash = [](const rule *r) { return get_hash(r); };
+  const auto equal = [](const rule *a, const rule *b) {
+    return is_equal(a, b);
+  };
+  std::unordered_map<const rule *, std::size_t, decltype(hash),
+                     decltype(equal)>
+      pending{glist.size(), hash, equal};
+
+  // Keys point at the last definition, which outlives the others
+  const auto *front = glist.front().get();
+  for (auto it = glist.rbegin(); it != --glist.rend(); ++it)
+    if (!is_equal(it->get(), front))
+      ++pending[it->get()];
+
   auto it = ++glist.begin();
   while (it != glist.end()) {
-    bool unique{true};
-    for (auto it2 = glist.begin(); it2 != glist.end(); ++it2) {
-      if (it == it2)
-        continue;
-      if (is_equal(it->get(), it2->get())) {
-        unique = false;
-        break;
-      }
-    }
-
-    if (!unique)
+    const auto entry = pending.find(it->get());
+    if (entry == pending.end() || entry->second > 1) {
+      if (entry != pending.end())
+        --entry->second;
       it = glist.erase(it);
-    else
+    } else
       ++it;
   }
 }
@@ -505,102 +774,192 @@ void to_cnf_start(grammar_list_t &glist, bool random) {
 
   if (scan_rhs(start))
     glist.push_front(std::unique_ptr<rule>{
-        new rule{make_unique_id(glist, start, random), {start}}});
+        new rule{symbol_allocator{glist}.make(start, random), {start}}});
 }
 
 // If a terminal symbol appears alongside
 // non-terminal symbols on the right-hand side
 // of a rule, create a new non-terminal rule
-// to represent the terminal and substitute it.
-void to_cnf_term(grammar_list_t &glist, bool random) {
-  auto nterm = get_nonterms(glist);
-  auto isterm = [&nterm](const std::string &s) { return !nterm.contains(s); };
-
-  auto replace = [isterm, &glist, random](std::vector<symbol_t> &rhs) {
-    if (rhs.size() < 2)
-      return;
-
-    for (auto &s : rhs)
-      if (isterm(s)) {
-        auto new_s = make_unique_id(glist, s, random);
-        glist.push_back(std::unique_ptr<rule>{new rule{new_s, {s}}});
-        s = std::move(new_s);
-      }
+// to represent the terminal and substitute it;
+// shared, every terminal gets a single proxy.
+void to_cnf_term(grammar_list_t &glist, bool random, bool share,
+                 std::size_t threads) {
+  const auto nterm = get_nonterms(glist);
+  const auto rules = get_rules(glist);
+
+  // Find the terminals to replace, in rule order
+  struct occurrence {
+    rule *r{};
+    std::size_t pos{}, name{};
   };
+  std::vector<std::vector<occurrence>> found(get_chunks(rules.size(), threads));
+  parallel_for(rules.size(), found.size(),
+               [&](std::size_t c, std::size_t b, std::size_t e) {
+                 for (auto i = b; i < e; ++i)
+                   if (rules[i]->rhs.size() >= 2)
+                     for (std::size_t k = 0; k < rules[i]->rhs.size(); ++k)
+                       if (!nterm.contains(rules[i]->rhs[k]))
+                         found[c].push_back({rules[i], k});
+               });
+
+  // Names are handed out in the same order as a single thread would
+  symbol_allocator names{glist};
+  std::unordered_map<symbol_t, std::size_t> proxies{};
+  std::vector<symbol_t> created{};
+  std::vector<std::unique_ptr<rule>> appended{};
+  for (auto &chunk : found)
+    for (auto &o : chunk) {
+      const auto &s = o.r->rhs[o.pos];
+      if (const auto it = proxies.find(s); it != proxies.end()) {
+        o.name = it->second;
+        continue;
+      }
+      o.name = created.size();
+      created.push_back(names.make(s, random));
+      appended.push_back(std::unique_ptr<rule>{new rule{created.back(), {s}}});
+      if (share)
+        proxies.emplace(s, o.name);
+    }
 
-  for (auto &r : glist)
-    replace(r->rhs);
+  parallel_for(found.size(), found.size(),
+               [&](std::size_t c, std::size_t, std::size_t) {
+                 for (const auto &o : found[c])
+                   o.r->rhs[o.pos] = created[o.name];
+               });
+
+  for (auto &&r : appended)
+    glist.push_back(std::move(r));
 }
 
 // Introduce new binary rules for any production with
 // more than two non-terminal symbols on the right-hand
 // side; recursively transform until all rules have at
 // most two symbols on the right-hand side.
-void to_cnf_bin(grammar_list_t &glist, bool random) {
-  for (auto &r : glist) {
-    rule copy_rule{*r};
-    auto &current = copy_rule;
-    bool first{true};
-
-    while (current.rhs.size() >= 3) {
-      rule new_rule{.lhs = make_unique_id(glist, current.lhs, random)};
-
-      const std::size_t new_size{current.rhs.size() - 1};
-      new_rule.rhs.resize(new_size);
-      for (std::size_t i = new_size; i > 0; --i) {
-        new_rule.rhs[i - 1] = std::move(current.rhs[i]);
-        current.rhs.pop_back();
-      }
-      current.rhs.push_back(new_rule.lhs);
+void to_cnf_bin(grammar_list_t &glist, bool random, std::size_t threads) {
+  const auto rules = get_rules(glist);
+
+  // Names are handed out in the same order as a single thread would; each
+  // long rule gets the names of its chain
+  symbol_allocator names{glist};
+  std::vector<std::vector<symbol_t>> chains(rules.size());
+  for (std::size_t i = 0; i < rules.size(); ++i)
+    for (std::size_t k = rules[i]->rhs.size(); k >= 3; --k)
+      chains[i].push_back(names.make(
+          chains[i].size() ? chains[i].back() : rules[i]->lhs, random));
+
+  std::vector<std::vector<std::unique_ptr<rule>>> appended(
+      get_chunks(rules.size(), threads));
+  parallel_for(
+      rules.size(), appended.size(),
+      [&](std::size_t c, std::size_t b, std::size_t e) {
+        for (auto i = b; i < e; ++i) {
+          auto &r = *rules[i];
+          if (chains[i].empty())
+            continue;
+
+          // X1 ... Xk becomes X1 N1, N1 -> X2 N2, ..., N(k-2) -> X(k-1) Xk
+          auto rhs = std::move(r.rhs);
+          r.rhs = {std::move(rhs[0]), chains[i][0]};
+          for (std::size_t k = 1; k < chains[i].size(); ++k)
+            appended[c].push_back(std::unique_ptr<rule>{new rule{
+                chains[i][k - 1], {std::move(rhs[k]), chains[i][k]}}});
+          appended[c].push_back(std::unique_ptr<rule>{
+              new rule{chains[i].back(),
+                       {std::move(rhs[rhs.size() - 2]),
+                        std::move(rhs.back())}}});
+        }
+      });
+
+  for (auto &chunk : appended)
+    for (auto &&r : chunk)
+      glist.push_back(std::move(r));
+}
 
-      if (first) {
-        *r = std::move(current);
-        first = false;
-      } else
-        glist.push_back(std::unique_ptr<rule>{new rule{std::move(current)}});
+// Binarize right to left, so that every suffix of two
+// or more symbols is derived by a single non-terminal
+// which all rules ending with that suffix share.
+void to_cnf_bin_shared(grammar_list_t &glist, bool random) {
+  symbol_allocator names{glist};
+  std::map<std::pair<symbol_t, symbol_t>, symbol_t> suffixes{};
 
-      copy_rule = std::move(new_rule);
-      current = copy_rule;
+  for (auto &r : glist) {
+    if (r->rhs.size() < 3)
+      continue;
+
+    auto tail = std::move(r->rhs.back());
+    for (auto i = r->rhs.size() - 1; i-- > 1;) {
+      auto key = std::pair{std::move(r->rhs[i]), std::move(tail)};
+      if (const auto it = suffixes.find(key); it != suffixes.end()) {
+        tail = it->second;
+        continue;
+      }
+      tail = names.make(r->lhs, random);
+      glist.push_back(std::unique_ptr<rule>{
+          new rule{tail, {key.first, key.second}}});
+      suffixes.emplace(std::move(key), tail);
     }
 
-    if (!first)
-      glist.push_back(std::unique_ptr<rule>{new rule{std::move(current)}});
+    r->rhs.resize(1);
+    r->rhs.push_back(std::move(tail));
   }
 }
 
 // Remove rules with empty right-hand sides and replace them with
 // variants where the empty symbol is appended as needed.
-result to_cnf_del(grammar_list_t &glist, bool prune) {
-  const auto start = get_start(&glist);
-  const auto nullable = get_nullable(glist);
-  if (!nullable.size() || (nullable.size() == 1 && *nullable.begin() == start))
+result to_cnf_del(grammar_list_t &glist, const grammar_analysis &a,
+                  bool prune, std::size_t threads) {
+  const auto nullable = a.nullable.count();
+  if (!nullable || (nullable == 1 && a.nullable.test(a.start)))
     return result::success;
 
-  auto nterm = get_nonterms(glist);
+  const auto is_nullable = [&a](const symbol_t &s) {
+    return a.nullable.test(a.ids.at(s));
+  };
+  const std::set<symbol_t> nterm{a.symbols.begin(),
+                                 a.symbols.begin() + a.nonterminals};
 
-  for (auto r = glist.begin(); r != glist.end(); ++r) {
-    if ((*r)->rhs.size() > 2)
+  const auto rules = get_rules(glist);
+  for (const auto *r : rules)
+    if (r->rhs.size() > 2)
       return result::excessive_symbols;
-    if (!(*r)->rhs.size())
-      continue;
-    if ((*r)->rhs.size() == 1) {
-      if (nullable.contains((*r)->rhs.front()))
-        glist.push_back(std::unique_ptr<rule>{new rule{(*r)->lhs, {}}});
-    } else {
-      bool x1{false}, x2{false};
-      if (nullable.contains((*r)->rhs.front())) {
-        glist.push_back(
-            std::unique_ptr<rule>{new rule{(*r)->lhs, {(*r)->rhs.back()}}});
-        x1 = true;
-      }
-      if (nullable.contains((*r)->rhs.back())) {
-        glist.push_back(
-            std::unique_ptr<rule>{new rule{(*r)->lhs, {(*r)->rhs.front()}}});
-        x2 = true;
-      }
-      if (x1 && x2)
-        glist.push_back(std::unique_ptr<rule>{new rule{(*r)->lhs, {}}});
+
+  // The variants of a rule without its nullable symbols
+  const auto expand = [&is_nullable](const rule &r, auto &out) {
+    if (!r.rhs.size())
+      return;
+    if (r.rhs.size() == 1) {
+      if (is_nullable(r.rhs.front()))
+        out.push_back(std::unique_ptr<rule>{new rule{r.lhs, {}}});
+      return;
     }
+
+    const bool x1 = is_nullable(r.rhs.front());
+    const bool x2 = is_nullable(r.rhs.back());
+    if (x1)
+      out.push_back(std::unique_ptr<rule>{new rule{r.lhs, {r.rhs.back()}}});
+    if (x2)
+      out.push_back(std::unique_ptr<rule>{new rule{r.lhs, {r.rhs.front()}}});
+    if (x1 && x2)
+      out.push_back(std::unique_ptr<rule>{new rule{r.lhs, {}}});
+  };
+
+  // Variants of the variants are expanded as well; they have at most one
+  // symbol, so their variants are final
+  std::vector<const rule *> level{rules.begin(), rules.end()};
+  for (int depth = 0; depth < 2 && level.size(); ++depth) {
+    std::vector<grammar_t> appended(get_chunks(level.size(), threads));
+    parallel_for(level.size(), appended.size(),
+                 [&](std::size_t c, std::size_t b, std::size_t e) {
+                   for (auto i = b; i < e; ++i)
+                     expand(*level[i], appended[c]);
+                 });
+
+    level.clear();
+    for (auto &chunk : appended)
+      for (auto &&r : chunk) {
+        level.push_back(r.get());
+        glist.push_back(std::move(r));
+      }
   }
 
   rm_explicit_nullable(glist);
@@ -615,74 +974,165 @@ result to_cnf_del(grammar_list_t &glist, bool prune) {
 // directly maps to another non-terminal symbol.
 void to_cnf_unit(grammar_list_t &glist) {
   const auto nterms = get_nonterms(glist);
-  for (auto r = glist.begin(); r != glist.end();) {
-    if ((*r)->rhs.size() != 1 || !nterms.contains((*r)->rhs.front())) {
-      ++r;
+  const unit_closure closure{glist, nterms};
+
+  // Right hand sides every left hand side already has
+  std::vector<rhs_set_t> seen(closure.size());
+  for (std::size_t v = 0; v < closure.size(); ++v)
+    for (const auto *r : closure.get_rules(v))
+      if (!closure.is_unit(r))
+        seen[v].insert(&r->rhs);
+
+  // A unit rule is replaced in place by the first production it brings in,
+  // the others are appended; one that brings in nothing is kept.
+  grammar_list_t out{}, tail{};
+  for (auto &r : glist) {
+    if (!closure.is_unit(r.get())) {
+      out.push_back(std::move(r));
       continue;
     }
 
-    const std::vector<symbol_t> exclude{(*r)->rhs.front(), (*r)->lhs};
+    const auto &productions = closure.get(r->rhs.front());
+    auto &own = seen[closure.get_id(r->lhs)];
     bool inserted{false};
-    for (auto &&rhs : get_rhs(glist, (*r)->rhs.front(), exclude)) {
-      if (!inserted) {
-        (*r)->rhs = std::move(rhs);
-        inserted = true;
-      } else
-        glist.push_back(
-            std::unique_ptr<rule>{new rule{(*r)->lhs, std::move(rhs)}});
+    for (const auto *p : productions) {
+      if (!own.insert(&p->rhs).second)
+        continue;
+      (inserted ? tail : out)
+          .push_back(std::unique_ptr<rule>{new rule{r->lhs, p->rhs}});
+      inserted = true;
     }
 
-    if (inserted)
-      r = glist.begin();
-    else
-      ++r;
+    if (!productions.size())
+      out.push_back(std::move(r));
   }
+
+  out.splice(out.end(), tail);
+  glist = std::move(out);
 }
 
-// Eliminate rules that only have one right hand side that is not unique;
-// then replace the occurrence of their left hand sides with the first rule
-// with the same right hand side
+// Merge every group of equivalent non-terminals into the first one defined.
+// Non-terminals are equivalent when their sets of right hand sides are equal
+// once each symbol is replaced by its block. Starting from a single block,
+// blocks are split by that signature; when a block splits, the smaller parts
+// get new ids and only the blocks of their users are checked again.
 void to_cnf_reduce(grammar_list_t &glist) {
-  bool removed{false};
-  do {
-    removed = false;
-
-    std::unordered_map<std::string, std::size_t> occmap{};
-    for (auto it = glist.begin(); it != glist.end(); ++it) {
-      if (!occmap.contains((*it)->lhs))
-        occmap.emplace((*it)->lhs, 1);
-      else
-        ++occmap.at((*it)->lhs);
+  std::unordered_map<symbol_t, std::size_t> ids{};
+  std::vector<std::vector<rule *>> rules{};
+  for (const auto &r : glist) {
+    const auto [it, added] = ids.try_emplace(r->lhs, rules.size());
+    if (added)
+      rules.emplace_back();
+    rules[it->second].push_back(r.get());
+  }
+
+  const auto n = rules.size();
+  std::vector<std::vector<std::size_t>> users(n);
+  for (std::size_t v = 0; v < n; ++v)
+    for (const auto *r : rules[v])
+      for (const auto &s : r->rhs)
+        if (const auto it = ids.find(s); it != ids.end())
+          users[it->second].push_back(v);
+
+  // Terminals are numbered after every block id there can be
+  std::unordered_map<symbol_t, std::size_t> terms{};
+  std::vector<std::size_t> block(n);
+  const auto encode = [&](const symbol_t &s) {
+    if (const auto it = ids.find(s); it != ids.end())
+      return block[it->second];
+    return n + terms.try_emplace(s, terms.size()).first->second;
+  };
+
+  using signature_t = std::vector<std::vector<std::size_t>>;
+  const auto get_signature = [&](std::size_t v) {
+    signature_t sig{};
+    sig.reserve(rules[v].size());
+    for (const auto *r : rules[v]) {
+      auto &e = sig.emplace_back();
+      e.reserve(r->rhs.size());
+      for (const auto &s : r->rhs)
+        e.push_back(encode(s));
     }
+    std::sort(sig.begin(), sig.end());
+    sig.erase(std::unique(sig.begin(), sig.end()), sig.end());
+    return sig;
+  };
 
-    std::list<std::list<std::unique_ptr<rule>>::iterator> ids{};
-    std::unordered_map<std::string, std::string> replace{};
-    for (auto it = glist.begin(); it != glist.end();) {
-      if ((*it)->rhs.size() && occmap.at((*it)->lhs) == 1) {
-        auto it2 = ids.begin();
-        for (; it2 != ids.end(); ++it2)
-          if ((*(*it2))->rhs == (*it)->rhs &&
-              occmap.at((*it2)->get()->lhs) == 1)
-            break;
-        if (it2 == ids.end())
-          ids.push_back(it);
-        else if (it != *it2) {
-          replace.emplace((*it)->lhs, (*(*it2))->lhs);
-          it = glist.erase(it);
-          removed = true;
-          continue;
-        }
-      }
-      ++it;
+  if (!n)
+    return;
+  std::vector<std::vector<std::size_t>> blocks(1, std::vector<std::size_t>(n));
+  std::iota(blocks[0].begin(), blocks[0].end(), 0);
+  std::vector<std::size_t> work{0};
+  std::vector<bool> queued(n);
+  queued[0] = true;
+
+  while (work.size()) {
+    const auto b = work.back();
+    work.pop_back();
+    queued[b] = false;
+    if (blocks[b].size() < 2)
+      continue;
+
+    std::map<signature_t, std::vector<std::size_t>> parts{};
+    for (const auto v : blocks[b])
+      parts[get_signature(v)].push_back(v);
+    if (parts.size() < 2)
+      continue;
+
+    auto largest = parts.begin();
+    for (auto it = parts.begin(); it != parts.end(); ++it)
+      if (it->second.size() > largest->second.size())
+        largest = it;
+
+    blocks[b] = std::move(largest->second);
+    for (auto it = parts.begin(); it != parts.end(); ++it) {
+      if (it == largest)
+        continue;
+      const auto nb = blocks.size();
+      for (const auto v : it->second)
+        block[v] = nb;
+      blocks.push_back(std::move(it->second));
+
+      for (const auto v : blocks[nb])
+        for (const auto u : users[v])
+          if (!queued[block[u]] && blocks[block[u]].size() > 1) {
+            queued[block[u]] = true;
+            work.push_back(block[u]);
+          }
     }
+  }
 
-    if (replace.size()) {
-      for (auto it = glist.begin(); it != glist.end(); ++it)
-        for (auto &s : (*it)->rhs)
-          if (replace.contains(s))
-            s = replace.at(s);
+  // Every block is represented by its first defined member
+  std::vector<const symbol_t *> name(n);
+  for (const auto &members : blocks) {
+    const auto first = *std::min_element(members.begin(), members.end());
+    for (const auto v : members)
+      name[v] = &rules[first].front()->lhs;
+  }
+
+  const auto hash = [](const rule *r) { return get_hash(r); };
+  const auto equal = [](const rule *a, const rule *b) {
+    return is_equal(a, b);
+  };
+  std::unordered_set<const rule *, decltype(hash), decltype(equal)> kept{
+      glist.size(), hash, equal};
+  for (auto it = glist.begin(); it != glist.end();) {
+    const auto v = ids.at((*it)->lhs);
+    if (*name[v] != (*it)->lhs) {
+      it = glist.erase(it);
+      continue;
     }
-  } while (removed);
+
+    for (auto &s : (*it)->rhs)
+      if (const auto e = ids.find(s); e != ids.end() && *name[e->second] != s)
+        s = *name[e->second];
+
+    // Merging can turn distinct rules into copies of each other
+    if (!kept.insert(it->get()).second)
+      it = glist.erase(it);
+    else
+      ++it;
+  }
 }
 } // namespace cfg
 
@@ -709,40 +1159,474 @@ void group_rules(grammar_list_t &g) {
 }
 } // namespace
 
+namespace {
+#ifndef CFGTK_VERSION
+#define CFGTK_VERSION "unknown"
+#endif
+
+// Everything a conversion depends on, written out unambiguously with every
+// symbol preceded by its length. Entries store it in full, so inputs whose
+// hashes collide are told apart on load.
+std::string make_cache_key(const cfg::grammar_t *g, const cfg::cnf_info *i) {
+  std::string out{};
+  const auto put = [&out](std::uint64_t v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  };
+  const auto put_symbol = [&out, &put](std::string_view s) {
+    put(s.size());
+    out.append(s);
+  };
+
+  put_symbol(CFGTK_VERSION);
+  put(cfg::compiled_grammar_version);
+  put(static_cast<unsigned>(i->filter));
+  put(i->passes.size());
+  for (const auto p : i->passes)
+    put(static_cast<unsigned>(p));
+  put(g->size());
+  for (const auto &r : *g) {
+    put_symbol(r->lhs);
+    put(r->rhs.size());
+    for (const auto &s : r->rhs)
+      put_symbol(s);
+  }
+  return out;
+}
+
+std::string make_cache_path(std::string_view key, const cfg::cnf_info *i) {
+  stable_hash h{};
+  h.add(key);
+
+  std::stringstream name{};
+  name << std::hex << std::setw(16) << std::setfill('0') << h.value << ".cnf";
+  return (std::filesystem::path{i->cache_dir} / name.str()).string();
+}
+
+// An entry is this header, the key and then, at the next multiple of 8,
+// the compiled image of the converted grammar.
+constexpr char cache_magic[8]{'C', 'F', 'G', 'T', 'K', 'C', 'C', '\0'};
+
+struct cache_header {
+  char magic[8]{};
+  std::uint64_t key_size{};
+};
+
+std::uint64_t get_image_offset(std::uint64_t key_size) {
+  return (sizeof(cache_header) + key_size + 7) / 8 * 8;
+}
+
+bool load_cached(const std::string &path, std::string_view key,
+                 cfg::grammar_t *out) {
+  cfg::mapped_file m{};
+  if (cfg::map_file(path, &m) != cfg::map_status::mapped)
+    return false;
+
+  const auto file = m.view();
+  cache_header h{};
+  if (file.size() < sizeof(h))
+    return false;
+  std::memcpy(&h, file.data(), sizeof(h));
+  if (!std::equal(std::begin(cache_magic), std::end(cache_magic), h.magic) ||
+      h.key_size != key.size() || file.size() < get_image_offset(key.size()) ||
+      file.substr(sizeof(h), key.size()) != key)
+    return false;
+
+  cfg::grammar_view v{};
+  return cfg::to_view(file.substr(get_image_offset(key.size())), &v) ==
+             cfg::result::success &&
+         cfg::to_grammar(&v, out) == cfg::result::success;
+}
+
+// Writes to a private temporary file first and renames it into place, so
+// concurrent readers only ever see complete entries.
+void store_cached(const std::string &path, std::string_view key,
+                  const cfg::grammar_t *g) {
+  static std::atomic<unsigned> sequence{};
+  cfg::compiled_grammar c{};
+  if (cfg::compile(g, &c) != cfg::result::success)
+    return;
+
+  cache_header h{};
+  std::copy(std::begin(cache_magic), std::end(cache_magic), h.magic);
+  h.key_size = key.size();
+  std::string data(get_image_offset(key.size()), '\0');
+  std::memcpy(data.data(), &h, sizeof(h));
+  std::copy(key.begin(), key.end(), data.begin() + sizeof(h));
+  data += cfg::to_image(&c.view);
+
+  std::error_code ec{};
+  std::filesystem::create_directories(
+      std::filesystem::path{path}.parent_path(), ec);
+  const auto tmp = path + ".tmp." + std::to_string(::getpid()) + "." +
+                   std::to_string(sequence++);
+  {
+    std::ofstream str{tmp, std::ios::binary | std::ios::trunc};
+    str.write(data.data(), static_cast<std::streamsize>(data.size()));
+    str.close();
+    if (!str)
+      ec = std::make_error_code(std::errc::io_error);
+  }
+  if (!ec)
+    std::filesystem::rename(tmp, path, ec);
+  if (ec)
+    std::filesystem::remove(tmp, ec);
+}
+} // namespace
+
+namespace {
+// State shared by the passes of one conversion. The passes work on the
+// node-based rule list; only the analysis, computed on demand and kept
+// until a pass that invalidates it runs, sees the rules as integer symbols.
+struct pass_context {
+  grammar_list_t grammar{};
+  const cfg::cnf_info *info{};
+  std::optional<cfg::grammar_analysis> analysis{};
+  // Reused by the pass stats to count symbols
+  std::vector<std::string_view> symbols{};
+
+  bool has(cfg::cnf_filter f) const { return bool(info->filter & f); }
+  std::size_t threads() const {
+    return info->threads ? info->threads
+                         : std::max(1u, std::thread::hardware_concurrency());
+  }
+};
+
+const cfg::grammar_analysis *get_analysis(pass_context *c,
+                                          cfg::analysis_set sets) {
+  if (!c->analysis || !c->analysis->has(sets)) {
+    std::vector<const cfg::rule *> rules{};
+    rules.reserve(c->grammar.size());
+    for (const auto &r : c->grammar)
+      rules.push_back(r.get());
+
+    cfg::grammar_analysis a{};
+    if (c->analysis)
+      sets = sets | c->analysis->computed;
+    if (cfg::analyze(&rules, &a, sets) != cfg::result::success)
+      return nullptr;
+    c->analysis = std::move(a);
+  }
+  return &*c->analysis;
+}
+
+struct pass_entry {
+  std::string_view name{};
+  cfg::result (*run)(pass_context *){};
+  // Whether the pass can change the sets the analysis holds; passes that
+  // only drop duplicate rules or reorder them cannot.
+  bool invalidates{true};
+};
+
+// Indexed by cfg::cnf_pass
+const pass_entry pass_table[]{
+    {"unique",
+     [](pass_context *c) {
+       cfg::make_unique(c->grammar);
+       return cfg::result::success;
+     },
+     false},
+    {"start",
+     [](pass_context *c) {
+       cfg::to_cnf_start(c->grammar, c->has(cfg::cnf_filter::random));
+       return cfg::result::success;
+     }},
+    {"term",
+     [](pass_context *c) {
+       cfg::to_cnf_term(c->grammar, c->has(cfg::cnf_filter::random),
+                        c->has(cfg::cnf_filter::share_term), c->threads());
+       return cfg::result::success;
+     }},
+    {"bin",
+     [](pass_context *c) {
+       if (c->has(cfg::cnf_filter::share_bin))
+         cfg::to_cnf_bin_shared(c->grammar, c->has(cfg::cnf_filter::random));
+       else
+         cfg::to_cnf_bin(c->grammar, c->has(cfg::cnf_filter::random),
+                         c->threads());
+       return cfg::result::success;
+     }},
+    {"del",
+     [](pass_context *c) {
+       if (c->grammar.empty())
+         return cfg::result::success;
+       const auto *a = get_analysis(c, cfg::analysis_set::nullable);
+       if (!a)
+         return cfg::result::format_error;
+       return cfg::to_cnf_del(c->grammar, *a, c->has(cfg::cnf_filter::prune),
+                              c->threads());
+     }},
+    {"unit",
+     [](pass_context *c) {
+       cfg::to_cnf_unit(c->grammar);
+       return cfg::result::success;
+     }},
+    {"reduce",
+     [](pass_context *c) {
+       cfg::to_cnf_reduce(c->grammar);
+       return cfg::result::success;
+     }},
+    {"group",
+     [](pass_context *c) {
+       group_rules(c->grammar);
+       return cfg::result::success;
+     },
+     false},
+    {"useless", [](pass_context *c) {
+       cfg::grammar_t g{};
+       g.reserve(c->grammar.size());
+       for (auto &&r : c->grammar)
+         g.push_back(std::move(r));
+       const auto r = cfg::remove_useless(&g, c->info->useless);
+       c->grammar.clear();
+       for (auto &&e : g)
+         c->grammar.push_back(std::move(e));
+       return r;
+     }}};
+
+// Null for values outside cfg::cnf_pass, which cnf_info::passes may hold
+const pass_entry *find_pass(cfg::cnf_pass p) {
+  const auto i = static_cast<std::size_t>(p);
+  return i < std::size(pass_table) ? &pass_table[i] : nullptr;
+}
+
+bool has_valid_passes(const cfg::cnf_info *info) {
+  return std::all_of(info->passes.begin(), info->passes.end(),
+                     [](cfg::cnf_pass p) { return find_pass(p); });
+}
+
+std::vector<cfg::cnf_pass> get_passes(const cfg::cnf_info *info) {
+  if (info->passes.size())
+    return info->passes;
+
+  using cfg::cnf_filter, cfg::cnf_pass;
+  const std::pair<cnf_filter, cnf_pass> order[]{
+      {cnf_filter::unique0, cnf_pass::unique},
+      {cnf_filter::useless0, cnf_pass::useless},
+      {cnf_filter::start, cnf_pass::start},
+      {cnf_filter::term, cnf_pass::term},
+      {cnf_filter::bin, cnf_pass::bin},
+      {cnf_filter::del, cnf_pass::del},
+      {cnf_filter::unique1, cnf_pass::unique},
+      {cnf_filter::unit, cnf_pass::unit},
+      {cnf_filter::unique2, cnf_pass::unique},
+      {cnf_filter::reduce, cnf_pass::reduce},
+      {cnf_filter::useless1, cnf_pass::useless},
+      {cnf_filter::group, cnf_pass::group}};
+
+  std::vector<cnf_pass> out{};
+  for (const auto &[f, p] : order)
+    if (bool(info->filter & f))
+      out.push_back(p);
+  return out;
+}
+
+// Fails the conversion before the input is touched in the cases where it
+// would fail later: for an unknown pass, and for a useless pass when the
+// start symbol derives nothing, which none of the passes changes.
+cfg::result check_input(const cfg::grammar_t *input,
+                        const cfg::cnf_info *info) {
+  if (!has_valid_passes(info))
+    return cfg::result::format_error;
+  const auto passes = get_passes(info);
+  if (std::find(passes.begin(), passes.end(), cfg::cnf_pass::useless) ==
+      passes.end())
+    return cfg::result::success;
+
+  cfg::grammar_analysis a{};
+  if (auto r = cfg::analyze(input, &a, cfg::analysis_set::productive);
+      r != cfg::result::success)
+    return r;
+  return a.productive.test(a.start) ? cfg::result::success
+                                    : cfg::result::match_failure;
+}
+
+// Whether a pass can fail after earlier ones changed the rules: useless,
+// when the grammar it is given derives nothing, and del, on the rules
+// longer than two symbols that only a bin pass before it splits.
+bool may_fail(const cfg::cnf_info *info) {
+  bool bin{};
+  for (const auto p : get_passes(info)) {
+    if (p == cfg::cnf_pass::bin)
+      bin = true;
+    else if (p == cfg::cnf_pass::useless || (p == cfg::cnf_pass::del && !bin))
+      return true;
+  }
+  return false;
+}
+
+// The number of distinct symbols, sorted in the context's reused buffer of
+// views so that counting allocates nothing once the buffer has grown
+std::size_t count_symbols(pass_context *c) {
+  auto &s = c->symbols;
+  s.clear();
+  for (const auto &r : c->grammar) {
+    s.push_back(r->lhs);
+    s.insert(s.end(), r->rhs.begin(), r->rhs.end());
+  }
+  std::sort(s.begin(), s.end());
+  return static_cast<std::size_t>(std::unique(s.begin(), s.end()) -
+                                  s.begin());
+}
+
+cfg::result run_pass(pass_context *c, cfg::cnf_pass p) {
+  const auto *entry = find_pass(p);
+  if (!entry)
+    return cfg::result::format_error;
+  if (!c->info->stats) {
+    const auto r = entry->run(c);
+    if (entry->invalidates)
+      c->analysis.reset();
+    return r;
+  }
+
+  // No pass both creates symbols and drops others, so the symbols it
+  // created are the ones it added to the count
+  const auto before = count_symbols(c);
+  cfg::cnf_pass_stats st{.pass = p, .rules_in = c->grammar.size()};
+  const auto begin = std::chrono::steady_clock::now();
+  const auto r = entry->run(c);
+  st.time = std::chrono::steady_clock::now() - begin;
+  if (entry->invalidates)
+    c->analysis.reset();
+
+  st.rules_out = c->grammar.size();
+  st.symbols_created = std::max(before, count_symbols(c)) - before;
+  c->info->stats->passes.push_back(st);
+  return r;
+}
+
+struct cache_slot {
+  std::string path{};
+  std::string key{};
+};
+
+// Looks the input up in the cache, if there is one and no pass report is
+// asked for; the slot is left empty when the result is not to be stored.
+bool find_cached(const cfg::grammar_t *input, const cfg::cnf_info *info,
+                 cache_slot *slot, cfg::grammar_t *out) {
+  if (!info->cache_dir.size() || bool(info->filter & cfg::cnf_filter::random))
+    return false;
+
+  slot->key = make_cache_key(input, info);
+  slot->path = make_cache_path(slot->key, info);
+  // The reports only come from running the passes, which a hit skips; the
+  // result is still stored
+  if (info->stats || info->useless)
+    return false;
+
+  cfg::grammar_t hit{};
+  if (load_cached(slot->path, slot->key, &hit)) {
+    if (info->cache_stats)
+      ++info->cache_stats->hits;
+    for (auto &&r : hit)
+      out->push_back(std::move(r));
+    return true;
+  }
+  if (info->cache_stats)
+    ++info->cache_stats->misses;
+  return false;
+}
+
+cfg::result convert(grammar_list_t glist, const cache_slot &slot,
+                    cfg::grammar_t *out, const cfg::cnf_info *info) {
+  pass_context c{.grammar = std::move(glist), .info = info};
+  for (const auto p : get_passes(info))
+    if (auto r = run_pass(&c, p); r != cfg::result::success)
+      return r;
+  auto &g = c.grammar;
+
+  if (slot.path.size()) {
+    // Only grammars whose right hand sides fit the compiled format are
+    // stored; the others are simply converted again next time.
+    cfg::grammar_t converted{};
+    converted.reserve(g.size());
+    for (auto &&r : g)
+      converted.push_back(std::move(r));
+    store_cached(slot.path, slot.key, &converted);
+    for (auto &&r : converted)
+      out->push_back(std::move(r));
+    return cfg::result::success;
+  }
+
+  out->reserve(out->size() + g.size());
+  for (auto &&r : g)
+    out->push_back(std::move(r));
+  return cfg::result::success;
+}
+} // namespace
+
 namespace cfg {
+std::string to_string(const cnf_stats *s) {
+  if (!s)
+    return {};
+
+  std::stringstream out{};
+  out << std::left << std::setw(8) << "pass" << std::right << std::setw(12)
+      << "time [us]" << std::setw(12) << "rules in" << std::setw(12)
+      << "rules out" << std::setw(12) << "created" << '\n';
+  for (const auto &p : s->passes) {
+    const auto us =
+        std::chrono::duration_cast<std::chrono::microseconds>(p.time);
+    const auto *entry = find_pass(p.pass);
+    out << std::left << std::setw(8) << (entry ? entry->name : "?")
+        << std::right << std::setw(12) << us.count() << std::setw(12)
+        << p.rules_in << std::setw(12) << p.rules_out << std::setw(12)
+        << p.symbols_created << '\n';
+  }
+  return out.str();
+}
+
 result to_cnf(const grammar_t *input, grammar_t *out, const cnf_info *info) {
   if (!input || !input->size() || !out || !info)
     return {};
+  if (auto r = check_input(input, info); r != result::success)
+    return r;
 
-  const bool rm_unreachable = bool(info->filter & cnf_filter::prune);
-  const bool random_id = bool(info->filter & cnf_filter::random);
-  auto g = flt::to_container<std::list>(*input);
-
-  if (bool(info->filter & cnf_filter::unique0))
-    make_unique(g);
-  if (bool(info->filter & cnf_filter::start))
-    to_cnf_start(g, random_id);
-  if (bool(info->filter & cnf_filter::term))
-    to_cnf_term(g, random_id);
-  if (bool(info->filter & cnf_filter::bin))
-    to_cnf_bin(g, random_id);
-  if (bool(info->filter & cnf_filter::del))
-    if (auto r = to_cnf_del(g, rm_unreachable); r != result::success)
-      return r;
-  if (bool(info->filter & cnf_filter::unique1))
-    make_unique(g);
-  if (bool(info->filter & cnf_filter::unit))
-    to_cnf_unit(g);
-  if (bool(info->filter & cnf_filter::unique2))
-    make_unique(g);
-  if (bool(info->filter & cnf_filter::reduce))
-    to_cnf_reduce(g);
-  if (bool(info->filter & cnf_filter::group))
-    group_rules(g);
+  cache_slot slot{};
+  if (find_cached(input, info, &slot, out))
+    return result::success;
+  return convert(flt::to_container<std::list>(*input), slot, out, info);
+}
 
-  for (auto &&r : g)
-    out->push_back(std::move(r));
-  return result::success;
+result to_cnf(grammar_t &&input, grammar_t *out, const cnf_info *info) {
+  if (!input.size() || !out || !info)
+    return {};
+  if (auto r = check_input(&input, info); r != result::success)
+    return r;
+
+  cache_slot slot{};
+  if (find_cached(&input, info, &slot, out)) {
+    input.clear();
+    return result::success;
+  }
+
+  // Converted from a copy, so that a pass failing halfway leaves the input
+  // as it was
+  if (may_fail(info)) {
+    const auto r =
+        convert(flt::to_container<std::list>(input), slot, out, info);
+    if (r == result::success)
+      input.clear();
+    return r;
+  }
+
+  // The rules change owners, none of them is copied
+  grammar_list_t glist{};
+  for (auto &&r : input)
+    glist.push_back(std::move(r));
+  input.clear();
+  return convert(std::move(glist), slot, out, info);
+}
+
+result to_cnf(grammar_t *g, const cnf_info *info) {
+  if (!g || !g->size() || !info)
+    return {};
+
+  grammar_t out{};
+  const auto r = to_cnf(std::move(*g), &out, info);
+  if (r == result::success)
+    *g = std::move(out);
+  return r;
 }
 
 std::vector<chart_node> get_trees(const chart_t *c, const symbol_t &start) {
@@ -1034,32 +1918,69 @@ std::string to_string(const chart_node *root, const token_sequence_t *tokens,
 }
 } // namespace cfg
 
-namespace cfg {
-result read_from_file(const std::string &path, grammar_t *g) {
-  std::ifstream str{path};
-  if (!str.is_open())
-    return result::file_access_failure;
+namespace {
+const char *find_char(const char *begin, const char *end, char c) {
+  // memchr is vectorized by the C library
+  const auto *p = std::memchr(begin, c, static_cast<std::size_t>(end - begin));
+  return p ? static_cast<const char *>(p) : end;
+}
 
-  std::string record{};
-  while (std::getline(str, record)) {
-    if (!record.size())
+// Parses the text grammar format in place: one rule per line, the LHS up
+// to the first space and every non-empty space-separated field after it on
+// the RHS. Symbols are constructed once, directly in the rule that owns them.
+void parse_grammar(std::string_view data, cfg::grammar_t *g) {
+  if (!g)
+    return;
+
+  const char *p = data.data(), *const end = data.data() + data.size();
+  std::size_t lines{1};
+  for (const char *l = p; (l = find_char(l, end, '\n')) != end; ++l)
+    ++lines;
+  g->reserve(g->size() + lines);
+
+  for (const char *eol = p; p < end; p = eol + (eol < end)) {
+    eol = find_char(p, end, '\n');
+    const char *lhs_end = find_char(p, eol, ' ');
+    if (p == eol)
       continue;
 
-    auto fields = flt::split<std::vector>(record, " ");
-    std::vector<symbol_t> rhs{};
-    rhs.reserve(fields.size());
-    for (std::size_t i = 1; i < fields.size(); ++i)
-      if (fields[i].size())
-        rhs.push_back(std::move(fields[i]));
-
-    if (g) {
-      if (rhs.size())
-        add_rule(g, std::move(fields[0]), std::move(rhs));
-      else
-        add_rule(g, std::move(fields[0]));
+    std::size_t fields{};
+    for (const char *f = lhs_end; f < eol;) {
+      const char *f_end = find_char(++f, eol, ' ');
+      fields += f_end > f;
+      f = f_end;
+    }
+
+    auto *r = cfg::add_rule(g, cfg::symbol_t{p, lhs_end});
+    r->rhs.reserve(fields);
+    for (const char *f = lhs_end; f < eol;) {
+      const char *f_end = find_char(++f, eol, ' ');
+      if (f_end > f)
+        r->rhs.emplace_back(f, f_end);
+      f = f_end;
     }
   }
+}
+} // namespace
+
+namespace cfg {
+result read_from_file(const std::string &path, grammar_t *g) {
+  mapped_file m{};
+  switch (map_file(path, &m)) {
+  case map_status::mapped:
+    parse_grammar(m.view(), g);
+    return result::success;
+  case map_status::failed:
+    return result::file_access_failure;
+  case map_status::unmappable:
+    break;
+  }
 
+  std::ifstream str{path, std::ios::binary};
+  if (!str.is_open())
+    return result::file_access_failure;
+  const std::string data{std::istreambuf_iterator<char>{str}, {}};
+  parse_grammar(data, g);
   return result::success;
 }
 } // namespace cfg
@@ -0,0 +1,106 @@
+#include <cfgtk/parser.hpp>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 4) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<expected-grammar-file> <input-grammar-file> <cache-dir>\n";
+    return 1;
+  }
+
+  cfg::grammar_t expd{}, input{};
+  std::vector<cfg::grammar_t *> gseq{&expd, &input};
+  for (std::size_t i = 0; i < gseq.size(); ++i) {
+    const std::size_t index = i + 1;
+    if (cfg::read_from_file(argv[index], gseq[i]) != cfg::result::success) {
+      std::cerr << "Reading grammar[" << index << "]  at: '" << argv[index]
+                << "' failed.\n";
+      return 2;
+    }
+  }
+
+  std::error_code ec{};
+  fs::remove_all(argv[3], ec);
+
+  cfg::cnf_cache_stats stats{};
+  cfg::cnf_info conf{};
+  conf.filter = cfg::cnf_filter::unique0 | cfg::cnf_filter::start |
+                cfg::cnf_filter::term | cfg::cnf_filter::bin |
+                cfg::cnf_filter::del | cfg::cnf_filter::unique1 |
+                cfg::cnf_filter::unit | cfg::cnf_filter::unique2 |
+                cfg::cnf_filter::group | cfg::cnf_filter::prune;
+  conf.cache_dir = argv[3];
+  conf.cache_stats = &stats;
+
+  // The first conversion populates the cache, the second one is served by it
+  cfg::grammar_t first{}, second{};
+  if (cfg::to_cnf(&input, &first, &conf) != cfg::result::success ||
+      cfg::to_cnf(&input, &second, &conf) != cfg::result::success) {
+    std::cerr << "Converting to CNF failed." << std::endl;
+    return 3;
+  }
+
+  if (stats.misses != 1 || stats.hits != 1) {
+    std::cerr << "Expected 1 miss and 1 hit, but have " << stats.misses
+              << " and " << stats.hits << std::endl;
+    return 4;
+  }
+
+  // A different filter must not share the entry
+  const auto filter = conf.filter;
+  conf.filter = filter | cfg::cnf_filter::reduce;
+  cfg::grammar_t third{};
+  cfg::to_cnf(&input, &third, &conf);
+  if (stats.misses != 2) {
+    std::cerr << "A different filter was served from the cache." << std::endl;
+    return 5;
+  }
+
+  // An entry of another grammar found under the same name, as after a hash
+  // collision, must not be served
+  cfg::grammar_t other{}, fourth{}, fifth{};
+  cfg::add_rule(&other, "start", "x");
+  auto other_conf = conf;
+  other_conf.cache_dir = (fs::path{argv[3]} / "other").string();
+  cfg::to_cnf(&other, &fourth, &other_conf);
+  for (const auto &o : fs::directory_iterator{other_conf.cache_dir})
+    for (const auto &f : fs::directory_iterator{argv[3]})
+      if (f.is_regular_file())
+        fs::copy_file(o.path(), f.path(), fs::copy_options::overwrite_existing);
+
+  conf.filter = filter;
+  const auto misses = stats.misses.load();
+  if (cfg::to_cnf(&input, &fifth, &conf) != cfg::result::success ||
+      stats.misses != misses + 1 || !is_equal(&fifth, &expd)) {
+    std::cerr << "The entry of another grammar was served." << std::endl;
+    return 6;
+  }
+
+  cfg::text_encoding e{};
+  if (!is_equal(&first, &expd) || !is_equal(&second, &expd)) {
+    std::cout << "CONVERTED GRAMMAR:\n"
+              << cfg::to_string(&first, &e) << std::endl;
+    std::cout << "CACHED GRAMMAR:\n"
+              << cfg::to_string(&second, &e) << std::endl;
+    std::cout << "EXPECTED GRAMMAR:\n"
+              << cfg::to_string(&expd, &e) << std::endl;
+    return 7;
+  }
+
+  // Asking for the pass stats runs the passes even with an entry cached,
+  // so that they are reported
+  cfg::cnf_stats pass_stats{};
+  conf.stats = &pass_stats;
+  const auto hits = stats.hits.load();
+  cfg::grammar_t sixth{};
+  if (cfg::to_cnf(&input, &sixth, &conf) != cfg::result::success ||
+      stats.hits != hits || pass_stats.passes.empty() ||
+      !is_equal(&sixth, &expd)) {
+    std::cerr << "The pass stats were not reported with an entry cached.\n";
+    return 8;
+  }
+}
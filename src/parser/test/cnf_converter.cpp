@@ -52,4 +52,60 @@ int main(int argc, char **argv) {
               << cfg::to_string(&expd, &e) << std::endl;
     return 4;
   }
+
+  // The overloads taking the input over must give the same grammar
+  cfg::grammar_t moved{}, in_place{};
+  cfg::read_from_file(argv[2], &moved);
+  cfg::read_from_file(argv[2], &in_place);
+  cfg::grammar_t gv_moved{};
+  if (cfg::to_cnf(std::move(moved), &gv_moved, &conf) !=
+          cfg::result::success ||
+      cfg::to_cnf(&in_place, &conf) != cfg::result::success) {
+    std::cerr << "Converting to CNF without a copy failed." << std::endl;
+    return 5;
+  }
+  if (moved.size() || !is_equal(&gv_moved, &expd) ||
+      !is_equal(&in_place, &expd)) {
+    std::cout << "MOVED GRAMMAR:\n"
+              << cfg::to_string(&gv_moved, &e) << std::endl;
+    std::cout << "IN-PLACE GRAMMAR:\n"
+              << cfg::to_string(&in_place, &e) << std::endl;
+    return 6;
+  }
+
+  // A conversion that fails leaves the input as it was: here the useless
+  // pass finds that the start symbol derives nothing
+  cfg::grammar_t empty{}, kept{}, unused{};
+  cfg::add_rule(&empty, "S", "S", "a");
+  cfg::add_rule(&empty, "S", "b", "S");
+  cfg::add_rule(&kept, "S", "S", "a");
+  cfg::add_rule(&kept, "S", "b", "S");
+  auto useless = conf;
+  useless.filter = conf.filter | cfg::cnf_filter::useless1;
+  if (cfg::to_cnf(&empty, &useless) != cfg::result::match_failure ||
+      cfg::to_cnf(std::move(empty), &unused, &useless) !=
+          cfg::result::match_failure ||
+      !is_equal(&empty, &kept)) {
+    std::cout << "INPUT AFTER A FAILED CONVERSION:\n"
+              << cfg::to_string(&empty, &e) << std::endl;
+    return 7;
+  }
+
+  // So does one that fails after other passes ran: del takes no rule
+  // longer than two symbols, which only bin before it would have split
+  cfg::grammar_t long_rule{}, long_kept{};
+  for (auto *g : {&long_rule, &long_kept}) {
+    cfg::add_rule(g, "S", "a", "B", "c");
+    cfg::add_rule(g, "B");
+  }
+  auto del = conf;
+  del.filter = cfg::cnf_filter::term | cfg::cnf_filter::del;
+  if (cfg::to_cnf(&long_rule, &del) != cfg::result::excessive_symbols ||
+      cfg::to_cnf(std::move(long_rule), &unused, &del) !=
+          cfg::result::excessive_symbols ||
+      !is_equal(&long_rule, &long_kept) || unused.size()) {
+    std::cout << "INPUT AFTER A FAILED CONVERSION:\n"
+              << cfg::to_string(&long_rule, &e) << std::endl;
+    return 8;
+  }
 }
@@ -0,0 +1,87 @@
+#include <cfgtk/parser.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 3) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<expected-grammar-file> <input-grammar-file>\n";
+    return 1;
+  }
+
+  cfg::grammar_t expd{}, input{};
+  std::vector<cfg::grammar_t *> gseq{&expd, &input};
+  for (std::size_t i = 0; i < gseq.size(); ++i) {
+    const std::size_t index = i + 1;
+    if (cfg::read_from_file(argv[index], gseq[i]) != cfg::result::success) {
+      std::cerr << "Reading grammar[" << index << "]  at: '" << argv[index]
+                << "' failed.\n";
+      return 2;
+    }
+  }
+
+  // The order the filter bits select, given explicitly
+  cfg::cnf_stats stats{};
+  cfg::cnf_info conf{};
+  conf.filter = cfg::cnf_filter::prune;
+  conf.passes = {cfg::cnf_pass::unique, cfg::cnf_pass::start,
+                 cfg::cnf_pass::term,   cfg::cnf_pass::bin,
+                 cfg::cnf_pass::del,    cfg::cnf_pass::unique,
+                 cfg::cnf_pass::unit,   cfg::cnf_pass::unique,
+                 cfg::cnf_pass::group};
+  conf.stats = &stats;
+
+  cfg::grammar_t gv{};
+  if (cfg::to_cnf(&input, &gv, &conf) != cfg::result::success) {
+    std::cerr << "Converting to CNF failed." << std::endl;
+    return 3;
+  }
+
+  cfg::text_encoding e{};
+  if (!is_equal(&gv, &expd)) {
+    std::cout << "PROCESSED GRAMMAR:\n" << cfg::to_string(&gv, &e) << std::endl;
+    std::cout << "EXPECTED GRAMMAR:\n"
+              << cfg::to_string(&expd, &e) << std::endl;
+    return 4;
+  }
+
+  // Every pass is reported, and each one starts where the previous stopped
+  bool consistent = stats.passes.size() == conf.passes.size() &&
+                    stats.passes.front().rules_in == input.size() &&
+                    stats.passes.back().rules_out == gv.size();
+  for (std::size_t i = 0; consistent && i < stats.passes.size(); ++i) {
+    consistent = stats.passes[i].pass == conf.passes[i];
+    if (consistent && i)
+      consistent = stats.passes[i].rules_in == stats.passes[i - 1].rules_out;
+  }
+  // term makes proxies, while unique and group only drop or move rules
+  if (!consistent || !stats.passes[2].symbols_created ||
+      stats.passes[0].symbols_created || stats.passes[8].symbols_created) {
+    std::cout << "UNEXPECTED STATISTICS:\n" << cfg::to_string(&stats);
+    return 5;
+  }
+
+  // A header and one line per pass
+  const auto table = cfg::to_string(&stats);
+  if (std::count(table.begin(), table.end(), '\n') !=
+      static_cast<long>(stats.passes.size() + 1)) {
+    std::cout << "UNEXPECTED TABLE:\n" << table;
+    return 6;
+  }
+
+  // A pass outside cnf_pass is rejected before the input is taken over
+  conf.passes = {cfg::cnf_pass::unique, static_cast<cfg::cnf_pass>(1000)};
+  cfg::grammar_t rejected{};
+  const auto size = input.size();
+  if (cfg::to_cnf(&input, &rejected, &conf) != cfg::result::format_error ||
+      cfg::to_cnf(std::move(input), &rejected, &conf) !=
+          cfg::result::format_error ||
+      input.size() != size) {
+    std::cerr << "An unknown pass was not rejected." << std::endl;
+    return 7;
+  }
+}
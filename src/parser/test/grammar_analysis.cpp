@@ -0,0 +1,83 @@
+#include <cfgtk/analysis.hpp>
+#include <filesystem>
+#include <iostream>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace {
+// Every expected line is read as a rule: the set name followed by, for
+// FIRST and FOLLOW, the non-terminal and then the elements; '$' stands
+// for the end of input
+std::set<cfg::symbol_t> to_names(const cfg::grammar_analysis &a,
+                                 const cfg::symbol_set &s) {
+  std::set<cfg::symbol_t> out{};
+  for (std::size_t i = 0; i < s.size(); ++i)
+    if (s.test(i))
+      out.emplace(i == a.end_of_input() ? "$" : a.symbols[i]);
+  return out;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 3) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<grammar-file> <expected-analysis-file>\n";
+    return 1;
+  }
+
+  cfg::grammar_t input{}, expd{};
+  std::vector<cfg::grammar_t *> gseq{&input, &expd};
+  for (std::size_t i = 0; i < gseq.size(); ++i) {
+    const std::size_t index = i + 1;
+    if (cfg::read_from_file(argv[index], gseq[i]) != cfg::result::success) {
+      std::cerr << "Reading file[" << index << "]  at: '" << argv[index]
+                << "' failed.\n";
+      return 2;
+    }
+  }
+
+  cfg::grammar_analysis a{};
+  if (cfg::analyze(&input, &a) != cfg::result::success) {
+    std::cerr << "The analysis failed." << std::endl;
+    return 3;
+  }
+
+  for (const auto &line : expd) {
+    std::set<cfg::symbol_t> names{line->rhs.begin(), line->rhs.end()};
+    const cfg::symbol_set *actual{};
+    if (line->lhs == "nullable")
+      actual = &a.nullable;
+    else if (line->lhs == "productive")
+      actual = &a.productive;
+    else if (line->lhs == "reachable")
+      actual = &a.reachable;
+    else if (line->rhs.size()) {
+      const auto s = a.get_id(line->rhs.front());
+      names.erase(line->rhs.front());
+      if (s == cfg::no_symbol || a.is_terminal(s))
+        actual = nullptr;
+      else if (line->lhs == "first")
+        actual = &a.first[s];
+      else if (line->lhs == "follow")
+        actual = &a.follow[s];
+    }
+
+    if (!actual) {
+      std::cerr << "Bad expectation for: " << line->lhs << std::endl;
+      return 4;
+    }
+
+    if (to_names(a, *actual) != names) {
+      std::cerr << "Mismatch for: " << line->lhs;
+      for (const auto &n : line->rhs)
+        std::cerr << ' ' << n;
+      std::cerr << "; got:";
+      for (const auto &n : to_names(a, *actual))
+        std::cerr << ' ' << n;
+      std::cerr << std::endl;
+      return 5;
+    }
+  }
+}
@@ -0,0 +1,51 @@
+#include <cfgtk/parser.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 3) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<grammar-file> <scratch-fifo-path>\n";
+    return 1;
+  }
+
+  cfg::grammar_t expd{};
+  if (cfg::read_from_file(argv[1], &expd) != cfg::result::success ||
+      expd.empty()) {
+    std::cerr << "Reading grammar at: '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  const std::string fifo{argv[2]};
+  std::error_code ec{};
+  fs::remove(fifo, ec);
+  if (::mkfifo(fifo.c_str(), 0600) != 0) {
+    std::cerr << "Creating the FIFO at: '" << fifo << "' failed.\n";
+    return 3;
+  }
+
+  // A FIFO reports no size, so it has to be read as a stream
+  std::jthread writer{[&argv, &fifo] {
+    std::ifstream in{argv[1], std::ios::binary};
+    std::ofstream out{fifo, std::ios::binary};
+    out << in.rdbuf();
+  }};
+
+  cfg::grammar_t g{};
+  const auto r = cfg::read_from_file(fifo, &g);
+  writer.join();
+  fs::remove(fifo, ec);
+
+  if (r != cfg::result::success || !cfg::is_equal(&g, &expd)) {
+    cfg::text_encoding e{};
+    std::cout << "READ FROM FIFO:\n" << cfg::to_string(&g, &e) << std::endl;
+    std::cout << "READ FROM FILE:\n" << cfg::to_string(&expd, &e) << std::endl;
+    return 4;
+  }
+}
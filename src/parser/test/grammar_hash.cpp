@@ -0,0 +1,57 @@
+#include <cfgtk/parser.hpp>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 5) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<grammar-file> <grammar-file> <ordered-equal 0|1> "
+                 "<unordered-equal 0|1>\n";
+    return 1;
+  }
+
+  cfg::grammar_t g1{}, g2{};
+  std::vector<cfg::grammar_t *> gseq{&g1, &g2};
+  for (std::size_t i = 0; i < gseq.size(); ++i) {
+    const std::size_t index = i + 1;
+    if (cfg::read_from_file(argv[index], gseq[i]) != cfg::result::success) {
+      std::cerr << "Reading grammar[" << index << "]  at: '" << argv[index]
+                << "' failed.\n";
+      return 2;
+    }
+  }
+
+  const bool ordered{std::string{argv[3]} == "1"};
+  const bool unordered{std::string{argv[4]} == "1"};
+  const cfg::hash_mode modes[]{cfg::hash_mode::ordered,
+                               cfg::hash_mode::unordered};
+
+  for (const auto m : modes) {
+    const bool expected = m == cfg::hash_mode::ordered ? ordered : unordered;
+    const auto h1 = cfg::get_hash(&g1, m), h2 = cfg::get_hash(&g2, m);
+    if (cfg::is_equal(&h1, &h2) != expected ||
+        cfg::is_equal(&g1, &g2, m) != expected) {
+      std::cerr << "Mode " << static_cast<int>(m) << ": expected "
+                << (expected ? "equal" : "different") << " grammars.\n";
+      return 3;
+    }
+  }
+
+  // Fingerprints maintained rule by rule must match the whole-grammar ones
+  cfg::grammar_hash inc{.mode = cfg::hash_mode::unordered};
+  for (const auto &r : g1)
+    cfg::add_rule(&inc, r.get());
+  for (const auto &r : g1)
+    cfg::add_rule(&inc, r.get());
+  for (const auto &r : g1)
+    cfg::remove_rule(&inc, r.get());
+
+  const auto whole = cfg::get_hash(&g1, cfg::hash_mode::unordered);
+  if (!cfg::is_equal(&inc, &whole)) {
+    std::cerr << "The incremental fingerprint does not match." << std::endl;
+    return 4;
+  }
+}
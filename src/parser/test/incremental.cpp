@@ -0,0 +1,167 @@
+#include <cfgtk/incremental.hpp>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace {
+const std::vector<cfg::symbol_t> alphabet{"plus",  "times", "lp", "rp", "num",
+                                          "minus", "id",    "g",  "x",  "x#0"};
+constexpr std::size_t max_length{4};
+
+enum class update { partial, full };
+
+struct edit {
+  update kind{};
+  std::optional<cfg::rule_handle_t> target{};
+  std::optional<cfg::rule> value{};
+};
+
+bool next_sentence(std::vector<std::size_t> *digits) {
+  for (auto &d : *digits)
+    if (++d < alphabet.size())
+      return true;
+    else
+      d = 0;
+  if (digits->size() == max_length)
+    return false;
+  digits->push_back(0);
+  return true;
+}
+
+// Compares the languages of both grammars on every sentence up to
+// max_length symbols long
+bool is_equivalent(const cfg::grammar_view *a, const cfg::grammar_view *b) {
+  std::vector<std::size_t> digits{};
+  do {
+    cfg::token_sequence_t t{};
+    for (const auto d : digits)
+      t.push_back({alphabet[d], alphabet[d]});
+    if (cfg::recognize(a, &t) != cfg::recognize(b, &t)) {
+      std::cerr << "The grammars differ on:";
+      for (const auto &s : t)
+        std::cerr << ' ' << s.id;
+      std::cerr << '\n';
+      return false;
+    }
+  } while (next_sentence(&digits));
+  return true;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 2) {
+    std::cerr << "Too few parameters; Usage: <input-grammar-file>\n";
+    return 1;
+  }
+
+  cfg::grammar_t input{};
+  if (cfg::read_from_file(argv[1], &input) != cfg::result::success) {
+    std::cerr << "Reading the grammar at: '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  std::vector<std::optional<cfg::rule>> source{};
+  for (const auto &r : input)
+    source.push_back(*r);
+
+  cfg::incremental_grammar g{};
+  if (cfg::to_cnf(&input, &g) != cfg::result::success ||
+      cfg::publish(&g) != cfg::result::success) {
+    std::cerr << "The incremental conversion failed.\n";
+    return 3;
+  }
+
+  // Parses keep running on whichever snapshot is current
+  std::jthread reader{[&g](std::stop_token stop) {
+    const cfg::token_sequence_t t{{"num", "1"}, {"plus", "+"}, {"num", "2"}};
+    while (!stop.stop_requested())
+      if (const auto c = cfg::get_snapshot(&g); !c)
+        std::abort();
+      else
+        cfg::recognize(&c->view, &t);
+  }};
+
+  const std::vector<edit> edits{
+      {update::partial, {}, cfg::rule{"F", {"minus", "F"}}},
+      {update::partial, {}, cfg::rule{"F", {"num", "num", "num"}}},
+      {update::partial, 7, {}},
+      {update::partial, 5, cfg::rule{"F", {"id"}}},
+      {update::partial, {}, cfg::rule{"T", {"lp", "rp", "times", "F"}}},
+      {update::full, {}, cfg::rule{"T", {"E"}}},
+      {update::full, {}, cfg::rule{"E", {}}},
+      {update::partial, {}, cfg::rule{"E", {"E", "plus", "T", "plus"}}},
+      {update::full, {}, cfg::rule{"G", {"g"}}},
+      {update::full, {}, cfg::rule{"T", {"G"}}},
+      {update::full, 9, {}},
+      // The proxy of x must not be named after the terminal x#0
+      {update::partial, {}, cfg::rule{"F", {"x", "x#0"}}},
+  };
+
+  for (std::size_t i = 0; i < edits.size(); ++i) {
+    const auto &e = edits[i];
+    const auto stats = g.stats;
+    auto r = cfg::result::success;
+    if (!e.target) {
+      source.push_back(*e.value);
+      r = cfg::add_rule(&g, *e.value);
+    } else if (!e.value) {
+      source[*e.target].reset();
+      r = cfg::remove_rule(&g, *e.target);
+    } else {
+      source[*e.target] = *e.value;
+      r = cfg::replace_rule(&g, *e.target, *e.value);
+    }
+
+    const bool partial = g.stats.partial == stats.partial + 1 &&
+                         g.stats.full == stats.full;
+    if (r != cfg::result::success || cfg::publish(&g) != cfg::result::success ||
+        partial != (e.kind == update::partial)) {
+      std::cerr << "Edit " << i << " failed or took the wrong path.\n";
+      return 4;
+    }
+
+    cfg::grammar_t edited{}, cnf{};
+    for (const auto &s : source)
+      if (s)
+        cfg::add_rule(&edited, s->lhs, s->rhs);
+    cfg::cnf_info info{};
+    cfg::compiled_grammar expd{};
+    if (cfg::to_cnf(&edited, &cnf, &info) != cfg::result::success ||
+        cfg::compile(&cnf, &expd) != cfg::result::success) {
+      std::cerr << "The full conversion of edit " << i << " failed.\n";
+      return 5;
+    }
+
+    const auto snapshot = cfg::get_snapshot(&g);
+    if (!is_equivalent(&expd.view, &snapshot->view)) {
+      std::cerr << "Edit " << i << " changed the language.\n";
+      return 6;
+    }
+
+    // Fresh non-terminals must not take the name of a source terminal
+    std::unordered_set<cfg::symbol_t> terminals{};
+    for (const auto &r : edited)
+      terminals.insert(r->rhs.begin(), r->rhs.end());
+    for (const auto &r : edited)
+      terminals.erase(r->lhs);
+    cfg::grammar_t current{};
+    cfg::get_grammar(&g, &current);
+    for (const auto &r : current)
+      if (terminals.contains(r->lhs)) {
+        std::cerr << "Edit " << i << " named a non-terminal '" << r->lhs
+                  << "' after a terminal.\n";
+        return 7;
+      }
+  }
+
+  if (cfg::remove_rule(&g, 7) != cfg::result::match_failure) {
+    std::cerr << "A removed rule was removed again.\n";
+    return 8;
+  }
+  return 0;
+}
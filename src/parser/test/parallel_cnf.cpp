@@ -0,0 +1,79 @@
+#include <cfgtk/parser.hpp>
+#include <filesystem>
+#include <iostream>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace {
+// Copies of the grammar with renamed non-terminals, all reachable from the
+// original start symbol
+cfg::grammar_t replicate(const cfg::grammar_t &g, std::size_t copies) {
+  std::set<cfg::symbol_t> nterms{};
+  for (const auto &r : g)
+    nterms.insert(r->lhs);
+
+  cfg::grammar_t out{};
+  const auto start = cfg::get_start(&g);
+  for (std::size_t i = 0; i < copies; ++i) {
+    const auto rename = [&](const cfg::symbol_t &s) {
+      return nterms.contains(s) ? s + "_" + std::to_string(i) : s;
+    };
+    cfg::add_rule(&out, start, rename(start));
+    for (const auto &r : g) {
+      auto *n = cfg::add_rule(&out, rename(r->lhs));
+      for (const auto &s : r->rhs)
+        n->rhs.push_back(rename(s));
+    }
+  }
+  return out;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 2) {
+    std::cerr << "Too few parameters; Usage: <input-grammar-file>\n";
+    return 1;
+  }
+
+  cfg::grammar_t input{};
+  if (cfg::read_from_file(argv[1], &input) != cfg::result::success) {
+    std::cerr << "Reading grammar at: '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+  const auto big = replicate(input, 2000);
+
+  cfg::cnf_info conf{};
+  conf.filter = cfg::cnf_filter::unique0 | cfg::cnf_filter::start |
+                cfg::cnf_filter::term | cfg::cnf_filter::bin |
+                cfg::cnf_filter::del | cfg::cnf_filter::unique1 |
+                cfg::cnf_filter::unit | cfg::cnf_filter::unique2 |
+                cfg::cnf_filter::group | cfg::cnf_filter::prune;
+
+  for (const auto share : {false, true}) {
+    if (share)
+      conf.filter = conf.filter | cfg::cnf_filter::share_term;
+
+    cfg::grammar_t serial{};
+    conf.threads = 1;
+    if (cfg::to_cnf(&big, &serial, &conf) != cfg::result::success) {
+      std::cerr << "Converting on one thread failed." << std::endl;
+      return 3;
+    }
+
+    for (const std::size_t threads : {2, 3, 8}) {
+      cfg::grammar_t parallel{};
+      conf.threads = threads;
+      if (cfg::to_cnf(&big, &parallel, &conf) != cfg::result::success) {
+        std::cerr << "Converting on " << threads << " threads failed.\n";
+        return 4;
+      }
+      if (!cfg::is_equal(&serial, &parallel)) {
+        std::cerr << "The output on " << threads
+                  << " threads differs from the output on one thread.\n";
+        return 5;
+      }
+    }
+  }
+}
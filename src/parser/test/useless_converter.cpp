@@ -0,0 +1,86 @@
+#include <cfgtk/analysis.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::vector<cfg::symbol_t> split(const std::string &list) {
+  std::vector<cfg::symbol_t> out{};
+  std::stringstream str{list};
+  for (std::string s{}; std::getline(str, s, ',');)
+    if (s.size())
+      out.push_back(s);
+  std::sort(out.begin(), out.end());
+  return out;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 5) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<expected-grammar-file> <input-grammar-file> "
+                 "<unproductive,...> <unreachable,...>\n";
+    return 1;
+  }
+
+  cfg::grammar_t expd{}, input{}, out{};
+  std::vector<cfg::grammar_t *> gseq{&expd, &input};
+  for (std::size_t i = 0; i < gseq.size(); ++i) {
+    const std::size_t index = i + 1;
+    if (cfg::read_from_file(argv[index], gseq[i]) != cfg::result::success) {
+      std::cerr << "Reading grammar[" << index << "]  at: '" << argv[index]
+                << "' failed.\n";
+      return 2;
+    }
+  }
+
+  cfg::useless_report report{};
+  cfg::cnf_info info{};
+  info.filter = cfg::cnf_filter::unique0 | cfg::cnf_filter::useless0;
+  info.useless = &report;
+  if (cfg::to_cnf(&input, &out, &info) != cfg::result::success) {
+    std::cerr << "Removing useless symbols failed." << std::endl;
+    return 3;
+  }
+
+  cfg::text_encoding e{};
+  if (!is_equal(&out, &expd)) {
+    std::cout << "PROCESSED GRAMMAR:\n"
+              << cfg::to_string(&out, &e) << std::endl;
+    std::cout << "EXPECTED GRAMMAR:\n"
+              << cfg::to_string(&expd, &e) << std::endl;
+    return 4;
+  }
+
+  std::sort(report.unproductive.begin(), report.unproductive.end());
+  std::sort(report.unreachable.begin(), report.unreachable.end());
+  if (report.unproductive != split(argv[3]) ||
+      report.unreachable != split(argv[4]) ||
+      report.rules != input.size() - out.size()) {
+    std::cerr << "Unexpected report: " << report.unproductive.size()
+              << " unproductive, " << report.unreachable.size()
+              << " unreachable, " << report.rules << " rules." << std::endl;
+    return 5;
+  }
+
+  // A grammar whose start symbol derives nothing is left alone
+  cfg::grammar_t empty{};
+  cfg::add_rule(&empty, "S", "S", "a");
+  if (cfg::remove_useless(&empty) != cfg::result::match_failure ||
+      empty.size() != 1) {
+    std::cerr << "An empty language should not be trimmed." << std::endl;
+    return 6;
+  }
+
+  // The pass is opt-in; the default conversion accepts such a grammar
+  cfg::grammar_t converted{};
+  const cfg::cnf_info defaults{};
+  if (cfg::to_cnf(&empty, &converted, &defaults) != cfg::result::success) {
+    std::cerr << "The default conversion removed useless symbols.\n";
+    return 7;
+  }
+}
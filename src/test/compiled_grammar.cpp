@@ -0,0 +1,67 @@
+#include <cyk_driver.hpp>
+#include <detail/compiled_image.hpp>
+#include <algorithm>
+
+int main(int argc, char **argv) {
+  cyk_case c{};
+  if (auto r = load_cyk_case(argc, argv, 1, "<binary-file> ", &c))
+    return r;
+  const auto &binary = c.extra.front();
+
+  // Export the compiled grammar and load it back through a mapping
+  {
+    cfg::compiled_grammar cg{};
+    if (cfg::compile(&c.grammar, &cg) != cfg::result::success ||
+        cfg::write_to_file(binary, &cg.view) != cfg::result::success) {
+      std::cerr << "Exporting the compiled grammar failed." << std::endl;
+      return 5;
+    }
+  }
+
+  cfg::compiled_grammar loaded{};
+  if (cfg::read_from_file(binary, &loaded) != cfg::result::success) {
+    std::cerr << "Loading the compiled grammar failed." << std::endl;
+    return 6;
+  }
+
+  cfg::grammar_t rg{};
+  cfg::text_encoding e{};
+  cfg::to_grammar(&loaded.view, &rg);
+  if (!cfg::is_equal(&c.grammar, &rg)) {
+    std::cout << "CNF GRAMMAR:\n"
+              << cfg::to_string(&c.grammar, &e) << std::endl;
+    std::cout << "LOADED GRAMMAR:\n" << cfg::to_string(&rg, &e) << std::endl;
+    return 7;
+  }
+
+  const bool compiled = cfg::recognize(&loaded.view, &c.tokens);
+  if (c.generic != compiled || c.expected != compiled) {
+    std::cerr << "Expected: " << to_verdict(c.expected) << std::endl;
+    std::cerr << "But have: generic " << to_verdict(c.generic)
+              << ", compiled " << to_verdict(compiled) << std::endl;
+    return 8;
+  }
+
+  // Tables out of order are binary searched into wrong answers, so an
+  // image holding one is rejected
+  std::vector<cfg::symbol_id_t> by_name{loaded.view.by_name.begin(),
+                                        loaded.view.by_name.end()};
+  std::vector<cfg::compiled_rule> index{loaded.view.index.begin(),
+                                        loaded.view.index.end()};
+  std::reverse(by_name.begin(), by_name.end());
+  std::reverse(index.begin(), index.end());
+  for (int i = 0; i < 2; ++i) {
+    auto v = loaded.view;
+    if (i)
+      v.index = index;
+    else
+      v.by_name = by_name;
+    cfg::grammar_view out{};
+    const auto image = cfg::to_image(&v);
+    if (cfg::to_view(image, &out) != cfg::result::format_error) {
+      std::cerr << "An image with its " << (i ? "rules" : "symbols")
+                << " out of order was loaded." << std::endl;
+      return 9;
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#include <cyk_driver.hpp>
+#include <cyk_parser_grammar_001.hpp>
+
+int main(int argc, char **argv) {
+  cyk_case c{};
+  if (auto r = load_cyk_case(argc, argv, 0, "", &c))
+    return r;
+
+  std::vector<std::string_view> ids{};
+  for (const auto &t : c.tokens)
+    ids.push_back(t.id);
+
+  const auto sc = cyk_001::parse(ids);
+  const bool specialized = cyk_001::is_valid(sc, ids.size());
+  if (c.generic != specialized || c.expected != specialized) {
+    std::cerr << "Expected: " << to_verdict(c.expected) << std::endl;
+    std::cerr << "But have: generic " << to_verdict(c.generic)
+              << ", specialized " << to_verdict(specialized) << std::endl;
+    return 5;
+  }
+
+  // Every node of the derivation must be backed by the generic chart
+  for (const auto &n : cyk_001::derive(sc, ids.size())) {
+    bool found{false};
+    for (const auto &cn : c.chart[n.end - n.begin][n.begin].nodes)
+      if (cn.rule.entry->lhs == cyk_001::symbols[n.symbol])
+        found = true;
+    if (!found) {
+      std::cerr << "Derived node '" << cyk_001::symbols[n.symbol] << "' ("
+                << n.begin << "," << n.end << ") is not in the chart.\n";
+      return 6;
+    }
+  }
+}
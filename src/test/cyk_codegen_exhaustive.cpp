@@ -0,0 +1,121 @@
+#include <cyk_driver.hpp>
+#include <cyk_grammar_002.hpp>
+#include <cyk_grammar_003.hpp>
+#include <cyk_grammar_004.hpp>
+#include <cyk_grammar_005.hpp>
+#include <cyk_grammar_006.hpp>
+#include <cyk_parser_grammar_001.hpp>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+using sequence_t = std::vector<std::string_view>;
+
+struct recognizer {
+  std::string_view name{};
+  bool (*recognize)(const sequence_t &){};
+};
+
+const recognizer recognizers[]{
+    {"cyk_001", cyk_001::recognize<sequence_t>},
+    {"cyk_002", cyk_002::recognize<sequence_t>},
+    {"cyk_003", cyk_003::recognize<sequence_t>},
+    {"cyk_004", cyk_004::recognize<sequence_t>},
+    {"cyk_005", cyk_005::recognize<sequence_t>},
+    {"cyk_006", cyk_006::recognize<sequence_t>},
+};
+
+// The symbols that never occur on a left-hand side, and a symbol that
+// occurs nowhere in the grammar
+std::vector<std::string> get_alphabet(const cfg::grammar_t *g) {
+  std::set<std::string> lhs{}, rhs{};
+  for (const auto &r : *g) {
+    lhs.insert(r->lhs);
+    rhs.insert(r->rhs.begin(), r->rhs.end());
+  }
+
+  std::vector<std::string> out{};
+  for (const auto &s : rhs)
+    if (!lhs.contains(s))
+      out.push_back(s);
+  out.push_back("#unknown");
+  return out;
+}
+} // namespace
+
+// Checks that the recognizer generated from a grammar agrees with cfg::cyk
+// on every token sequence up to the given length
+int main(int argc, char **argv) {
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  if (argc < 4) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<grammar-file> <namespace> <max-length>\n";
+    return 1;
+  }
+
+  cfg::grammar_t ig{};
+  if (cfg::read_from_file(argv[1], &ig) != cfg::result::success) {
+    std::cerr << "Reading grammar at: '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  const recognizer *rec{};
+  for (const auto &r : recognizers)
+    if (r.name == argv[2])
+      rec = &r;
+  if (!rec) {
+    std::cerr << "No recognizer was generated into: '" << argv[2] << "'\n";
+    return 3;
+  }
+
+  cfg::grammar_t g{};
+  if (to_test_cnf(&ig, &g) != cfg::result::success) {
+    std::cerr << "Converting grammar to CNF failed." << std::endl;
+    return 4;
+  }
+
+  const auto alphabet = get_alphabet(&ig);
+  const auto max_length = std::stoul(argv[3]);
+  const auto start = cfg::get_start(&g);
+
+  // Counts through every sequence over the alphabet in order of length
+  std::vector<std::size_t> digits{};
+  std::size_t accepted{};
+  while (digits.size() <= max_length) {
+    cfg::token_sequence_t tokens{};
+    sequence_t ids{};
+    for (auto d : digits) {
+      tokens.push_back({alphabet[d], alphabet[d]});
+      ids.push_back(alphabet[d]);
+    }
+
+    const auto ch = cfg::cyk(&g, &tokens);
+    const bool generic = cfg::is_valid(&ch, start);
+    if (generic != rec->recognize(ids)) {
+      std::cerr << "Disagreement on:";
+      for (const auto &id : ids)
+        std::cerr << " " << id;
+      std::cerr << "\nGeneric: " << (generic ? "OK" : "NOK") << std::endl;
+      return 5;
+    }
+    accepted += generic;
+
+    auto k = digits.size();
+    while (k && ++digits[k - 1] == alphabet.size())
+      digits[--k] = 0;
+    if (!k)
+      digits.insert(digits.begin(), 0);
+  }
+
+  // A grammar that derives nothing would agree trivially
+  if (!accepted) {
+    std::cerr << "No sequence up to length " << max_length
+              << " is accepted.\n";
+    return 6;
+  }
+}
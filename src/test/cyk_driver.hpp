@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cfgtk/lexer.hpp>
+#include <cfgtk/parser.hpp>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Shared by the system component tests that check a recognizer against
+// cfg::cyk, so that each of them only does what its recognizer adds.
+
+// The passes every test converts its grammar with
+inline constexpr cfg::cnf_filter test_cnf_filter =
+    cfg::cnf_filter::unique0 | cfg::cnf_filter::start | cfg::cnf_filter::term |
+    cfg::cnf_filter::bin | cfg::cnf_filter::del | cfg::cnf_filter::unique1 |
+    cfg::cnf_filter::unit | cfg::cnf_filter::unique2 | cfg::cnf_filter::group |
+    cfg::cnf_filter::prune;
+
+inline cfg::result to_test_cnf(const cfg::grammar_t *in, cfg::grammar_t *out) {
+  cfg::cnf_info conf{};
+  conf.filter = test_cnf_filter;
+  return cfg::to_cnf(in, out, &conf);
+}
+
+struct cyk_case {
+  cfg::grammar_t grammar{};
+  cfg::lexer_table_t table{};
+  // Arguments that come between the token table and the verdict
+  std::vector<std::string> extra{};
+  bool expected{};
+  cfg::token_sequence_t tokens{};
+  cfg::chart_t chart{};
+  bool generic{};
+};
+
+// Reads "<grammar-file> <token-table-file> [extra...] <OK|NOK>
+// [input-sequence]", converts the grammar to CNF and runs cfg::cyk on the
+// tokenized input. Returns the exit code of the test if that fails, or 0.
+inline int load_cyk_case(int argc, char **argv, std::size_t extra,
+                         const char *extra_usage, cyk_case *c) {
+  namespace fs = std::filesystem;
+  fs::current_path(fs::absolute(fs::path{argv[0]}.parent_path()));
+  const auto verdict = static_cast<int>(3 + extra);
+  if (argc <= verdict) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<grammar-file> <token-table-file> "
+              << extra_usage << "<OK|NOK> [input-sequence]\n";
+    return 1;
+  }
+
+  cfg::grammar_t ig{};
+  if (cfg::read_from_file(argv[1], &ig) != cfg::result::success) {
+    std::cerr << "Reading grammar at: '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  if (cfg::read_from_file(argv[2], &c->table) != cfg::result::success) {
+    std::cerr << "Reading token table at: '" << argv[2] << "' failed.\n";
+    return 3;
+  }
+
+  if (to_test_cnf(&ig, &c->grammar) != cfg::result::success) {
+    std::cerr << "Converting grammar to CNF failed." << std::endl;
+    return 4;
+  }
+
+  c->extra.assign(argv + 3, argv + verdict);
+  c->expected = std::string{argv[verdict]} == "OK";
+  std::vector<std::string> input{};
+  if (argc > verdict + 1)
+    input = flt::to_container<std::vector>(argc, argv, verdict + 1);
+  c->tokens = cfg::tokenize(&c->table, &input);
+  c->chart = cfg::cyk(&c->grammar, &c->tokens);
+  c->generic = cfg::is_valid(&c->chart, cfg::get_start(&c->grammar));
+  return 0;
+}
+
+inline const char *to_verdict(bool ok) { return ok ? "OK" : "NOK"; }
@@ -0,0 +1,31 @@
+#include <cyk_driver.hpp>
+
+// Converts a grammar file to CNF and writes the specialized CYK recognizer
+// generated from it; used by the build to produce the code under test.
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    std::cerr << "Too few parameters; Usage: "
+                 "<grammar-file> <output-file> <namespace>\n";
+    return 1;
+  }
+
+  cfg::grammar_t ig{};
+  if (cfg::read_from_file(argv[1], &ig) != cfg::result::success) {
+    std::cerr << "Reading grammar at: '" << argv[1] << "' failed.\n";
+    return 2;
+  }
+
+  cfg::grammar_t g{};
+  if (to_test_cnf(&ig, &g) != cfg::result::success) {
+    std::cerr << "Converting grammar to CNF failed." << std::endl;
+    return 3;
+  }
+
+  cfg::cyk_encoding e{};
+  e.namespace_name = argv[3];
+  if (cfg::write_to_file(argv[2], cfg::to_string(&g, &e) + "\n") !=
+      cfg::result::success) {
+    std::cerr << "Writing to: '" << argv[2] << "' failed.\n";
+    return 4;
+  }
+}
@@ -1,5 +1,4 @@
-#include <cfgtk/lexer.hpp>
-#include <cfgtk/parser.hpp>
+#include <cyk_driver.hpp>
 #include <filesystem>
 #include <iostream>
 
@@ -40,14 +39,7 @@ int main(int argc, char **argv) {
   const auto tokens = cfg::tokenize(&tbl, &input);
 
   cfg::grammar_t g{};
-  cfg::cnf_info conf{};
-  conf.filter = cfg::cnf_filter::unique0 | cfg::cnf_filter::start |
-                cfg::cnf_filter::term | cfg::cnf_filter::bin |
-                cfg::cnf_filter::del | cfg::cnf_filter::unique1 |
-                cfg::cnf_filter::unit | cfg::cnf_filter::unique2 |
-                cfg::cnf_filter::group | cfg::cnf_filter::prune;
-
-  if (cfg::to_cnf(&ig, &g, &conf) != cfg::result::success) {
+  if (to_test_cnf(&ig, &g) != cfg::result::success) {
     std::cerr << "Converting grammar to CNF failed." << std::endl;
     return 4;
   }
@@ -60,6 +52,15 @@ int main(int argc, char **argv) {
   const auto ch = cfg::cyk(&g, &tokens);
   const bool ok = cfg::is_valid(&ch, ss);
 
+  // Parsing the token references must give the same verdict
+  std::vector<cfg::token_ref> refs{};
+  cfg::tokenize(&tbl, nullptr, &input, &refs);
+  const auto rc = cfg::cyk(&g, &refs);
+  if (cfg::is_valid(&rc, ss) != ok) {
+    std::cerr << "Parsing the token references gave another result.\n";
+    return 5;
+  }
+
   std::cout << "parsing complete; result: " << (ok ? "OK" : "NOK") << "\n\n";
   if (tokens.size() <= 7)
     std::cout << cfg::to_string(&ch) << std::endl;
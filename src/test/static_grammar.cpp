@@ -0,0 +1,58 @@
+#include <cfgtk/static_grammar.hpp>
+#include <cyk_driver.hpp>
+#include <static_grammar_sources.hpp>
+
+namespace {
+// Converted to CNF entirely at compile time
+constexpr auto grammar_001 = cfg::make_static_grammar<source_001>();
+
+constexpr bool check_001() {
+  const auto v = grammar_001.view();
+  if (cfg::get_symbol(&v, v.start) != "start")
+    return false;
+  for (const auto &r : v.rules)
+    if (r.size > 2 || (!r.size && r.lhs != v.start))
+      return false;
+  return true;
+}
+static_assert(check_001(), "the static grammar is not in CNF");
+
+// The start symbol appears on a right hand side and is nullable, and the
+// long rule has to be binarized
+constexpr auto grammar_002 = cfg::make_static_grammar<"s a s b\ns\n">();
+
+constexpr bool check_002() {
+  const auto v = grammar_002.view();
+  bool empty{false};
+  for (const auto &r : v.rules)
+    empty = empty || (r.lhs == v.start && !r.size);
+  return cfg::get_symbol(&v, v.start) == "s#0" && empty &&
+         cfg::find_symbol(&v, "a#0") != cfg::no_symbol;
+}
+static_assert(check_002(), "the static grammar is not in CNF");
+} // namespace
+
+int main(int argc, char **argv) {
+  cyk_case c{};
+  if (auto r = load_cyk_case(argc, argv, 0, "", &c))
+    return r;
+
+  const auto view = grammar_001.view();
+  const bool compiled = cfg::recognize(&view, &c.tokens);
+
+  cfg::grammar_t sg{};
+  cfg::to_grammar(&view, &sg);
+  const auto sch = cfg::cyk(&sg, &c.tokens);
+  const bool materialized = cfg::is_valid(&sch, cfg::get_start(&sg));
+
+  if (c.generic != compiled || compiled != materialized ||
+      c.expected != compiled) {
+    cfg::text_encoding e{};
+    std::cerr << "Expected: " << to_verdict(c.expected) << std::endl;
+    std::cerr << "But have: generic " << to_verdict(c.generic)
+              << ", compiled " << to_verdict(compiled) << ", materialized "
+              << to_verdict(materialized) << std::endl;
+    std::cout << "STATIC GRAMMAR:\n" << cfg::to_string(&sg, &e) << std::endl;
+    return 5;
+  }
+}